@@ -0,0 +1,281 @@
+#include "coordinator.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+
+#include "job_queue.h"
+
+namespace
+{
+    // Longer than any message a worker sends; a peer past this without a newline is dropped
+    const qint64 MAX_LINE_BYTES = 1024 * 1024;
+    // Connections that have not said a valid hello by then are dropped
+    const int HELLO_TIMEOUT_MS = 5000;
+}
+
+Coordinator::Coordinator(JobQueue *queue, QObject *parent)
+    : QObject(parent), server(new QTcpServer(this)), queue(queue)
+{
+    connect(server, &QTcpServer::newConnection, this, &Coordinator::onNewConnection);
+    connect(queue, &JobQueue::jobQueued, this, &Coordinator::dispatch, Qt::QueuedConnection);
+    connect(queue, &JobQueue::remoteCancelRequested, this, &Coordinator::onRemoteCancelRequested);
+}
+
+Coordinator::~Coordinator()
+{
+    server->close();
+}
+
+bool Coordinator::listen(quint16 port, const QHostAddress &address)
+{
+    lastError.clear();
+    if (address.isNull())
+    {
+        lastError = "Invalid listen address";
+        return false;
+    }
+    if (token.isEmpty() && !address.isLoopback())
+    {
+        lastError = QString("Refusing to accept workers on %1 without a token").arg(address.toString());
+        return false;
+    }
+    if (!server->listen(address, port))
+    {
+        lastError = server->errorString();
+        return false;
+    }
+    return true;
+}
+
+QString Coordinator::errorString() const
+{
+    return lastError;
+}
+
+void Coordinator::setToken(const QString &token)
+{
+    this->token = token;
+}
+
+void Coordinator::onNewConnection()
+{
+    while (QTcpSocket *socket = server->nextPendingConnection())
+    {
+        // Registered on "hello"; until then the worker has no capacity
+        workers.insert(socket, Worker());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]()
+                { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]()
+                { onDisconnected(socket); });
+        QTimer::singleShot(HELLO_TIMEOUT_MS, socket, [this, socket]()
+                           {
+                               if (workers.contains(socket) && workers.value(socket).name.isEmpty())
+                               {
+                                   qDebug() << "Coordinator: no hello from" << socket->peerAddress().toString();
+                                   socket->abort();
+                               }
+                           });
+    }
+}
+
+void Coordinator::onReadyRead(QTcpSocket *socket)
+{
+    while (socket->canReadLine())
+    {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        const QJsonDocument document = QJsonDocument::fromJson(line);
+        if (!document.isObject())
+        {
+            qDebug() << "Coordinator: ignoring malformed message from" << socket->peerAddress().toString();
+            continue;
+        }
+        handleMessage(socket, document.object());
+    }
+    if (socket->bytesAvailable() > MAX_LINE_BYTES)
+    {
+        qDebug() << "Coordinator: dropping" << socket->peerAddress().toString() << "after an overlong message";
+        socket->abort();
+    }
+}
+
+void Coordinator::onDisconnected(QTcpSocket *socket)
+{
+    const Worker worker = workers.take(socket);
+    socket->deleteLater();
+    if (worker.name.isEmpty())
+        return;
+
+    emit logMessage(QString("Worker %1 disconnected (%2 jobs in flight).").arg(worker.name).arg(worker.jobIds.size()));
+    updateRemoteNodes();
+    for (int id : worker.jobIds)
+    {
+        queue->failClaimedJob(id, worker.name, -1, "worker disconnected");
+    }
+    dispatch();
+}
+
+void Coordinator::handleMessage(QTcpSocket *socket, const QJsonObject &message)
+{
+    Worker &worker = workers[socket];
+    const QString type = message.value("type").toString();
+
+    if (type == "hello")
+    {
+        if (!worker.name.isEmpty())
+            return;
+        if (message.value("token").toString() != token)
+        {
+            emit logMessage(QString("Rejected worker from %1: wrong token.").arg(socket->peerAddress().toString()));
+            send(socket, QJsonObject{{"type", "error"}, {"error", "wrong token"}});
+            socket->disconnectFromHost();
+            return;
+        }
+        QString name = message.value("name").toString(socket->peerAddress().toString());
+        // Names identify nodes for retries, so they must be unique
+        QString uniqueName = name;
+        for (int suffix = 2; socketForNode(uniqueName) != nullptr || uniqueName == JobQueue::LocalNode; ++suffix)
+        {
+            uniqueName = QString("%1#%2").arg(name).arg(suffix);
+        }
+        worker.name = uniqueName;
+        worker.slots = qMax(1, message.value("slots").toInt(1));
+        emit logMessage(QString("Worker %1 connected from %2 with %3 slots.")
+                            .arg(worker.name, socket->peerAddress().toString())
+                            .arg(worker.slots));
+        updateRemoteNodes();
+        dispatch();
+    }
+    else if (worker.name.isEmpty())
+    {
+        // Nothing but hello before the worker is registered
+        return;
+    }
+    else if (type == "progress")
+    {
+        const int id = message.value("id").toInt();
+        if (worker.jobIds.contains(id))
+            queue->updateJobProgress(id, message.value("outTime").toDouble(), message.value("fps").toDouble());
+    }
+    else if (type == "result")
+    {
+        handleResult(socket, message);
+        dispatch();
+    }
+    else if (type == "status")
+    {
+        worker.loadAverage = message.value("loadAverage").toDouble();
+    }
+}
+
+void Coordinator::handleResult(QTcpSocket *socket, const QJsonObject &message)
+{
+    Worker &worker = workers[socket];
+    const int id = message.value("id").toInt();
+    if (!worker.jobIds.remove(id))
+        return;
+
+    // Anything but a clean finish or a cancel (including a missing or unknown state) is a failure
+    const QString stateName = message.value("state").toString();
+    const EncodingJob::State state = stateName == "finished"    ? EncodingJob::State::Finished
+                                     : stateName == "cancelled" ? EncodingJob::State::Cancelled
+                                                                : EncodingJob::State::Failed;
+    const int exitCode = message.value("exitCode").toInt();
+    const QString error = message.value("error").toString();
+
+    emit logMessage(QString("Job #%1 %2 on %3 in %4 s (%5 fps).")
+                        .arg(id)
+                        .arg(encodingJobStateName(state), worker.name)
+                        .arg(message.value("wallSeconds").toDouble(), 0, 'f', 1)
+                        .arg(message.value("fps").toDouble(), 0, 'f', 0));
+
+    if (state == EncodingJob::State::Failed)
+    {
+        worker.failed++;
+        queue->failClaimedJob(id, worker.name, exitCode, error);
+    }
+    else
+    {
+        if (state == EncodingJob::State::Finished)
+            worker.completed++;
+        queue->completeClaimedJob(id, state, exitCode, error);
+    }
+}
+
+void Coordinator::dispatch()
+{
+    // Fill the node with the most free slots first; ties go to the less loaded box
+    bool assigned = true;
+    while (assigned && queue->pendingCount() > 0)
+    {
+        assigned = false;
+
+        QList<QTcpSocket *> candidates;
+        for (auto it = workers.constBegin(); it != workers.constEnd(); ++it)
+        {
+            if (!it->name.isEmpty() && it->jobIds.size() < it->slots)
+                candidates << it.key();
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](QTcpSocket *a, QTcpSocket *b)
+                  {
+            const Worker &wa = workers[a];
+            const Worker &wb = workers[b];
+            const int freeA = wa.slots - wa.jobIds.size();
+            const int freeB = wb.slots - wb.jobIds.size();
+            if (freeA != freeB)
+                return freeA > freeB;
+            return wa.loadAverage < wb.loadAverage; });
+
+        for (QTcpSocket *socket : std::as_const(candidates))
+        {
+            Worker &worker = workers[socket];
+            const auto job = queue->claimJob(worker.name);
+            if (!job)
+                continue; // Everything left already failed on this node
+            worker.jobIds.insert(job->id);
+            send(socket, QJsonObject{{"type", "assign"}, {"job", encodingJobToJson(*job)}, {"token", token}});
+            assigned = true;
+            break;
+        }
+    }
+}
+
+void Coordinator::onRemoteCancelRequested(int id, const QString &node)
+{
+    if (QTcpSocket *socket = socketForNode(node))
+    {
+        send(socket, QJsonObject{{"type", "cancel"}, {"id", id}, {"token", token}});
+    }
+}
+
+void Coordinator::updateRemoteNodes()
+{
+    QStringList names;
+    for (const Worker &worker : std::as_const(workers))
+    {
+        if (!worker.name.isEmpty())
+            names << worker.name;
+    }
+    queue->setRemoteNodes(names);
+}
+
+QTcpSocket *Coordinator::socketForNode(const QString &node) const
+{
+    for (auto it = workers.constBegin(); it != workers.constEnd(); ++it)
+    {
+        if (it->name == node)
+            return it.key();
+    }
+    return nullptr;
+}
+
+void Coordinator::send(QTcpSocket *socket, const QJsonObject &message)
+{
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n");
+}
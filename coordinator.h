@@ -0,0 +1,78 @@
+#ifndef _COORDINATOR_H
+#define _COORDINATOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QJsonObject>
+#include <QHostAddress>
+
+QT_BEGIN_NAMESPACE
+class QTcpServer;
+class QTcpSocket;
+QT_END_NAMESPACE
+
+class JobQueue;
+
+// Fans the jobs of a JobQueue out to encoder nodes running in worker mode (see WorkerNode).
+//
+// Protocol: one JSON object per line over TCP.
+//   worker -> coordinator  {"type":"hello","name":"box1","slots":4,"token":"..."}
+//   coordinator -> worker  {"type":"assign","job":{...},"token":"..."}
+//   worker -> coordinator  {"type":"progress","id":7,"outTime":12.5,"fps":240}
+//   worker -> coordinator  {"type":"result","id":7,"state":"finished","exitCode":0,"wallSeconds":31.2,"fps":236}
+//   worker -> coordinator  {"type":"status","running":2,"slots":4,"loadAverage":3.1}
+//   coordinator -> worker  {"type":"cancel","id":7,"token":"..."}
+//   coordinator -> worker  {"type":"error","error":"..."}   (then disconnects)
+// Job ids are the coordinator's. Inputs and outputs are exchanged through a path both sides can reach.
+// Both sides share a token: a worker whose hello lacks it is dropped, and a worker ignores
+// assignments without it, since an assignment names files to overwrite and ffmpeg arguments to run.
+class Coordinator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Coordinator(JobQueue *queue, QObject *parent = nullptr);
+    ~Coordinator() override;
+
+    // Listening beyond the loopback interface requires a token.
+    bool listen(quint16 port, const QHostAddress &address = QHostAddress::LocalHost);
+    QString errorString() const;
+
+    void setToken(const QString &token);
+
+signals:
+    void logMessage(const QString &text);
+
+private slots:
+    void onNewConnection();
+    void dispatch();
+
+private:
+    struct Worker
+    {
+        QString name;
+        int slots = 0;
+        QSet<int> jobIds;
+        int completed = 0;
+        int failed = 0;
+        double loadAverage = 0.0;
+    };
+
+    void onReadyRead(QTcpSocket *socket);
+    void onDisconnected(QTcpSocket *socket);
+    void handleMessage(QTcpSocket *socket, const QJsonObject &message);
+    void handleResult(QTcpSocket *socket, const QJsonObject &message);
+    void onRemoteCancelRequested(int id, const QString &node);
+    void updateRemoteNodes();
+    QTcpSocket *socketForNode(const QString &node) const;
+    void send(QTcpSocket *socket, const QJsonObject &message);
+
+    QTcpServer *server;
+    JobQueue *queue;
+    QString token;
+    QString lastError;
+    QHash<QTcpSocket *, Worker> workers;
+};
+
+#endif // _COORDINATOR_H
@@ -0,0 +1,235 @@
+#include "cpu_topology.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+namespace
+{
+    QString readSysfsLine(const QString &path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return QString();
+        return QString::fromLatin1(file.readLine()).trimmed();
+    }
+
+    // Groups CPUs into physical cores by their hyperthread siblings: "0,1,16,17" -> [0,16], [1,17]
+    QList<QList<int>> groupSiblings(const QList<int> &cpus)
+    {
+        QList<QList<int>> cores;
+        QHash<int, int> coreIndex; // lowest sibling -> index in 'cores'
+        for (int cpu : cpus)
+        {
+            const QList<int> siblings = CpuTopology::parseCpuList(
+                readSysfsLine(QString("/sys/devices/system/cpu/cpu%1/topology/thread_siblings_list").arg(cpu)));
+            const int key = siblings.isEmpty() ? cpu : *std::min_element(siblings.cbegin(), siblings.cend());
+            const auto it = coreIndex.constFind(key);
+            if (it == coreIndex.cend())
+            {
+                coreIndex.insert(key, cores.size());
+                cores << QList<int>{cpu};
+            }
+            else
+            {
+                cores[*it] << cpu;
+            }
+        }
+        return cores;
+    }
+}
+
+CpuTopology CpuTopology::detect()
+{
+    CpuTopology topology;
+#ifdef Q_OS_LINUX
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return topology;
+
+    const QDir nodeDir("/sys/devices/system/node");
+    QList<int> ids;
+    for (const QString &entry : nodeDir.entryList({"node*"}, QDir::Dirs))
+    {
+        bool ok = false;
+        const int id = entry.mid(4).toInt(&ok);
+        if (ok)
+            ids << id;
+    }
+    std::sort(ids.begin(), ids.end());
+
+    for (int id : std::as_const(ids))
+    {
+        QList<int> cpus;
+        for (int cpu : parseCpuList(readSysfsLine(nodeDir.filePath(QString("node%1/cpulist").arg(id)))))
+        {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                cpus << cpu;
+        }
+        // Memory-only nodes and nodes outside our cgroup/taskset
+        if (cpus.isEmpty())
+            continue;
+        topology.nodeCores << groupSiblings(cpus);
+        topology.nodeIds << id;
+    }
+
+    if (topology.nodeCores.isEmpty())
+    {
+        // Kernel without NUMA support: one node, nothing to bind memory to
+        QList<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+                cpus << cpu;
+        }
+        if (!cpus.isEmpty())
+        {
+            topology.nodeCores << groupSiblings(cpus);
+            topology.nodeIds << -1;
+        }
+    }
+#endif
+    return topology;
+}
+
+bool CpuTopology::isEmpty() const
+{
+    return nodeCores.isEmpty();
+}
+
+int CpuTopology::nodeCount() const
+{
+    return nodeCores.size();
+}
+
+int CpuTopology::cpuCount() const
+{
+    int count = 0;
+    for (const QList<QList<int>> &cores : nodeCores)
+    {
+        for (const QList<int> &core : cores)
+        {
+            count += core.size();
+        }
+    }
+    return count;
+}
+
+QList<CpuSet> CpuTopology::partition(int slots) const
+{
+    QList<CpuSet> sets;
+    if (nodeCores.isEmpty() || slots <= 0)
+        return sets;
+
+    const int nodes = nodeCores.size();
+    QList<int> slotsOnNode(nodes, 0);
+    for (int slot = 0; slot < slots; ++slot)
+    {
+        slotsOnNode[slot % nodes]++;
+    }
+
+    QList<int> usedOnNode(nodes, 0);
+    for (int slot = 0; slot < slots; ++slot)
+    {
+        const int node = slot % nodes;
+        const QList<QList<int>> &cores = nodeCores.at(node);
+        const int shares = slotsOnNode.at(node);
+        const int index = usedOnNode[node]++;
+
+        CpuSet set;
+        set.node = nodeIds.at(node);
+        // Whole cores only, so two encodes never share one through its hyperthreads
+        if (cores.size() >= shares)
+        {
+            const int begin = index * cores.size() / shares;
+            const int end = (index + 1) * cores.size() / shares;
+            for (int core = begin; core < end; ++core)
+            {
+                set.cpus << cores.at(core);
+            }
+        }
+        else
+        {
+            set.cpus = cores.at(index % cores.size());
+        }
+        sets << set;
+    }
+    return sets;
+}
+
+std::function<void()> CpuTopology::childModifier(const CpuSet &set, bool bindMemory)
+{
+#ifdef Q_OS_LINUX
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : set.cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &mask);
+    }
+    unsigned long nodeMask = 0;
+    const bool bind = bindMemory && set.node >= 0 && set.node < static_cast<int>(sizeof(nodeMask) * 8) - 1;
+    if (bind)
+        nodeMask = 1UL << set.node;
+
+    // Runs in the forked child, so only plain system calls. A failure leaves the default placement.
+    return [mask, nodeMask, bind]()
+    {
+        sched_setaffinity(0, sizeof(mask), &mask);
+        if (bind)
+            syscall(SYS_set_mempolicy, MPOL_BIND, &nodeMask, sizeof(nodeMask) * 8);
+    };
+#else
+    Q_UNUSED(set);
+    Q_UNUSED(bindMemory);
+    return {};
+#endif
+}
+
+QString CpuTopology::formatCpuList(const QList<int> &cpus)
+{
+    QList<int> sorted = cpus;
+    std::sort(sorted.begin(), sorted.end());
+
+    QStringList ranges;
+    for (int i = 0; i < sorted.size();)
+    {
+        int j = i;
+        while (j + 1 < sorted.size() && sorted.at(j + 1) == sorted.at(j) + 1)
+            ++j;
+        ranges << (i == j ? QString::number(sorted.at(i)) : QString("%1-%2").arg(sorted.at(i)).arg(sorted.at(j)));
+        i = j + 1;
+    }
+    return ranges.join(',');
+}
+
+QList<int> CpuTopology::parseCpuList(const QString &text)
+{
+    QList<int> cpus;
+    for (const QString &range : text.split(',', Qt::SkipEmptyParts))
+    {
+        const QStringList bounds = range.trimmed().split('-');
+        bool firstOk = false;
+        bool lastOk = false;
+        const int first = bounds.value(0).toInt(&firstOk);
+        const int last = bounds.size() > 1 ? bounds.value(1).toInt(&lastOk) : first;
+        if (!firstOk || (bounds.size() > 1 && !lastOk))
+            continue;
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus << cpu;
+        }
+    }
+    return cpus;
+}
@@ -0,0 +1,46 @@
+#ifndef _CPU_TOPOLOGY_H
+#define _CPU_TOPOLOGY_H
+
+#include <QList>
+#include <QString>
+
+#include <functional>
+
+// The CPUs one local ffmpeg process may run on, all from the same NUMA node.
+struct CpuSet
+{
+    QList<int> cpus;
+    int node = -1; // -1: no NUMA information, memory is never bound
+};
+
+// Host CPU layout, used to give each parallel job its own cores on a single NUMA node
+// instead of letting every encode's threads (and memory) spread over all sockets.
+class CpuTopology
+{
+public:
+    // Reads /sys/devices/system/node, restricted to the CPUs this process may run on.
+    // Without NUMA information all allowed CPUs form one node; on other systems the result is empty.
+    static CpuTopology detect();
+
+    bool isEmpty() const;
+    int nodeCount() const;
+    int cpuCount() const;
+
+    // Splits the CPUs into 'slots' sets of whole physical cores (with all their hyperthreads).
+    // Slots are spread over the nodes in turn and never cross one. With more slots than cores, slots share cores.
+    QList<CpuSet> partition(int slots) const;
+
+    // For QProcess::setChildProcessModifier(): applies 'set' in the child between fork and exec,
+    // and with 'bindMemory' restricts its allocations to the set's node. Empty where unsupported.
+    static std::function<void()> childModifier(const CpuSet &set, bool bindMemory);
+
+    // "0-3,8-11", the kernel's cpulist format
+    static QString formatCpuList(const QList<int> &cpus);
+    static QList<int> parseCpuList(const QString &text);
+
+private:
+    QList<QList<QList<int>>> nodeCores; // per node, per physical core, its CPUs
+    QList<int> nodeIds;
+};
+
+#endif // _CPU_TOPOLOGY_H
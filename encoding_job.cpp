@@ -0,0 +1,143 @@
+#include "encoding_job.h"
+
+#include <QJsonArray>
+
+QString encodingJobStateName(EncodingJob::State state)
+{
+    switch (state)
+    {
+    case EncodingJob::State::Queued:
+        return "queued";
+    case EncodingJob::State::Running:
+        return "running";
+    case EncodingJob::State::Finished:
+        return "finished";
+    case EncodingJob::State::Failed:
+        return "failed";
+    case EncodingJob::State::Cancelled:
+        return "cancelled";
+    }
+    return "unknown";
+}
+
+QJsonObject encodingJobToJson(const EncodingJob &job)
+{
+    QJsonObject object;
+    object["id"] = job.id;
+    object["origin"] = job.origin;
+    object["input"] = job.inputFile;
+    object["output"] = job.outputFile;
+    object["speed"] = job.speedFactor;
+
+    if (job.isMerge())
+    {
+        object["inputs"] = QJsonArray::fromStringList(job.mergeInputs);
+        if (job.isMergePrepared())
+        {
+            QJsonArray hasAudio;
+            QJsonArray durations;
+            for (int i = 0; i < job.mergeInputs.size(); ++i)
+            {
+                hasAudio.append(job.mergeInputHasAudio.value(i));
+                durations.append(job.mergeInputDurations.value(i));
+            }
+            QJsonObject canvas;
+            canvas["width"] = job.canvasWidth;
+            canvas["height"] = job.canvasHeight;
+            canvas["fps"] = job.canvasFps;
+            canvas["hasAudio"] = hasAudio;
+            canvas["durations"] = durations;
+            object["canvas"] = canvas;
+        }
+    }
+
+    QJsonObject overlay;
+    overlay["enabled"] = job.overlayEnabled;
+    overlay["fontPath"] = job.fontPath;
+    overlay["fontSize"] = job.fontSize;
+    object["overlay"] = overlay;
+
+    object["encoderArgs"] = QJsonArray::fromStringList(job.encoderArgs);
+    if (job.followGrowingInput)
+    {
+        object["follow"] = true;
+    }
+    if (job.inputDurationLimit > 0.0)
+    {
+        object["inputDurationLimit"] = job.inputDurationLimit;
+    }
+    if (job.scaleHeight > 0)
+    {
+        object["scaleHeight"] = job.scaleHeight;
+    }
+    object["priority"] = job.priority;
+    if (job.durationSeconds > 0.0)
+    {
+        object["duration"] = job.durationSeconds;
+    }
+    object["state"] = encodingJobStateName(job.state);
+    object["exitCode"] = job.exitCode;
+    if (!job.errorString.isEmpty())
+    {
+        object["error"] = job.errorString;
+    }
+    if (!job.assignedNode.isEmpty())
+    {
+        object["node"] = job.assignedNode;
+    }
+    object["attempts"] = job.attempts;
+
+    QJsonObject progress;
+    progress["outTime"] = job.progressSeconds;
+    progress["fps"] = job.fps;
+    object["progress"] = progress;
+    return object;
+}
+
+EncodingJob encodingJobFromJson(const QJsonObject &object)
+{
+    EncodingJob job;
+    job.inputFile = object.value("input").toString();
+    job.outputFile = object.value("output").toString();
+    job.speedFactor = object.value("speed").toDouble(job.speedFactor);
+
+    for (const QJsonValue &input : object.value("inputs").toArray())
+    {
+        job.mergeInputs << input.toString();
+    }
+    if (job.isMerge() && job.inputFile.isEmpty())
+    {
+        job.inputFile = job.mergeInputs.first();
+    }
+    // Present when a coordinator forwards an already probed merge job
+    const QJsonObject canvas = object.value("canvas").toObject();
+    if (!canvas.isEmpty())
+    {
+        job.canvasWidth = canvas.value("width").toInt();
+        job.canvasHeight = canvas.value("height").toInt();
+        job.canvasFps = canvas.value("fps").toDouble();
+        for (const QJsonValue &value : canvas.value("hasAudio").toArray())
+        {
+            job.mergeInputHasAudio << value.toBool();
+        }
+        for (const QJsonValue &value : canvas.value("durations").toArray())
+        {
+            job.mergeInputDurations << value.toDouble();
+        }
+    }
+
+    const QJsonObject overlay = object.value("overlay").toObject();
+    job.overlayEnabled = overlay.value("enabled").toBool(job.overlayEnabled);
+    job.fontPath = overlay.value("fontPath").toString(job.fontPath);
+    job.fontSize = overlay.value("fontSize").toInt(job.fontSize);
+
+    for (const QJsonValue &arg : object.value("encoderArgs").toArray())
+    {
+        job.encoderArgs << arg.toString();
+    }
+    job.followGrowingInput = object.value("follow").toBool(job.followGrowingInput);
+    job.inputDurationLimit = object.value("inputDurationLimit").toDouble(job.inputDurationLimit);
+    job.scaleHeight = object.value("scaleHeight").toInt(job.scaleHeight);
+    job.priority = object.value("priority").toInt(job.priority);
+    return job;
+}
@@ -0,0 +1,86 @@
+#ifndef _ENCODING_JOB_H
+#define _ENCODING_JOB_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QJsonObject>
+
+// A single unit of work for the encoder: one input, one output and the
+// parameters that used to be read straight from the widget's controls.
+// Jobs are self-contained so they can come from the UI or from the job server.
+struct EncodingJob
+{
+    enum class State
+    {
+        Queued,
+        Running,
+        Finished,
+        Failed,
+        Cancelled
+    };
+
+    int id = 0;
+    QString origin = "ui"; // "ui" or "ipc"; only UI jobs pop up message boxes
+
+    QString inputFile;
+    QString outputFile;
+    double speedFactor = 1.0;
+
+    // Merge jobs: several inputs concatenated (in order) into outputFile in one pass.
+    // inputFile is then the first of them. The per-input fields and the common canvas
+    // are filled in by JobQueue from ffprobe before the job becomes runnable.
+    QStringList mergeInputs;
+    QList<bool> mergeInputHasAudio;
+    QList<double> mergeInputDurations;
+    int canvasWidth = 0;
+    int canvasHeight = 0;
+    double canvasFps = 0.0;
+
+    bool overlayEnabled = false;
+    QString fontPath;
+    int fontSize = 64;
+
+    QStringList encoderArgs; // Extra output options, e.g. {"-c:v", "libx264", "-crf", "23"}
+    // Set by JobQueue when the job is pinned to a core set; 0 leaves thread counts to ffmpeg
+    int threads = 0;
+
+    // The input is still being recorded: it is fed to ffmpeg as it grows and the job
+    // ends once the writer closes it. Such jobs always run on this host and cannot be merges.
+    bool followGrowingInput = false;
+
+    // Preview renders: only read the first N seconds of input (0 = all) and
+    // downscale the result to this height (0 = keep the source resolution).
+    double inputDurationLimit = 0.0;
+    int scaleHeight = 0;
+
+    // Scheduling: higher priority runs first (pinned jobs); the probed duration
+    // and the input size drive the shortest/longest-first policies.
+    int priority = 0;
+    double durationSeconds = 0.0;
+    qint64 inputSize = 0;
+
+    State state = State::Queued;
+    int exitCode = 0;
+    QString errorString;
+
+    bool isMerge() const { return !mergeInputs.isEmpty(); }
+    bool isMergePrepared() const { return canvasWidth > 0 && mergeInputHasAudio.size() == mergeInputs.size(); }
+
+    // Where the job runs: "local" or the name of a remote worker
+    QString assignedNode;
+    int attempts = 0;
+    QStringList excludedNodes; // Nodes this job already failed on
+
+    // Last values reported by ffmpeg's -progress output
+    double progressSeconds = 0.0;
+    double fps = 0.0;
+};
+
+QString encodingJobStateName(EncodingJob::State state);
+
+QJsonObject encodingJobToJson(const EncodingJob &job);
+// Reads the parameters of a job (not its id or state). Missing fields keep their defaults.
+EncodingJob encodingJobFromJson(const QJsonObject &object);
+
+#endif // _ENCODING_JOB_H
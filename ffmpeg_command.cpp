@@ -0,0 +1,211 @@
+#include "ffmpeg_command.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+namespace FfmpegCommand
+{
+
+QString cleanDoubleString(double value)
+{
+    QString s = QString::number(value, 'f', 2);
+    s = s.replace(QRegularExpression("(\\.\\d*?[1-9])0+$"), "\\1"); // Remove unnecessary trailing zeros after decimal point
+    s = s.replace(QRegularExpression("\\.0+$"), ""); // Remove .00
+    if (s.endsWith('.')) s.chop(1);
+    return s;
+}
+
+QString defaultOutputPath(const QString &inputFile, const QString &outputDirectory, double speedFactor)
+{
+    QFileInfo inputFileInfo(inputFile);
+    return QDir(outputDirectory).filePath(QString("%1_x%2.%3")
+                                              .arg(inputFileInfo.completeBaseName())
+                                              .arg(cleanDoubleString(speedFactor))
+                                              .arg(inputFileInfo.suffix()));
+}
+
+QStringList speedVideoFilters(const EncodingJob &job, QStringList *warnings)
+{
+    const double speed = job.speedFactor;
+
+    QString videoFilterSetpts = QString("setpts=%1*PTS").arg(QString::number(1.0 / speed, 'f', 4));
+    QStringList videoFilters;
+    videoFilters << videoFilterSetpts;
+
+    if (job.overlayEnabled)
+    {
+        QString fontFile = job.fontPath;
+        QFileInfo fontInfo(fontFile);
+        if (fontFile.isEmpty() || !fontInfo.exists() || !fontInfo.isFile())
+        {
+            if (warnings)
+            {
+                warnings->append(QString("Warning: Font file '%1' not found or invalid for overlay on '%2'. Skipping overlay.")
+                                     .arg(fontFile, QFileInfo(job.inputFile).fileName()));
+            }
+        }
+        else
+        {
+            QString text = QString("x %1").arg(cleanDoubleString(speed));
+            QString escapedFontFile = fontFile;
+#ifdef Q_OS_WIN
+            escapedFontFile.replace("\\", "/");
+            escapedFontFile.replace(":", "\\\\:");
+#endif
+            qDebug() << "Escaped font path:" << escapedFontFile;
+            QString drawTextFilter = QString("drawtext=text='%1':fontcolor=white:fontsize=%2:x=w-tw-10:y=h-th-10:shadowcolor=black:shadowx=2:shadowy=2:fontfile=\"%3\"")
+                                         .arg(text.replace("'", "\\'"), QString::number(job.fontSize), escapedFontFile);
+            videoFilters << drawTextFilter;
+        }
+    }
+    if (job.scaleHeight > 0)
+    {
+        // Scale after drawtext so the overlay keeps its size relative to the frame; never upscale
+        videoFilters << QString("scale=-2:min(ih\\,%1)").arg(job.scaleHeight);
+    }
+    return videoFilters;
+}
+
+QStringList buildArguments(const EncodingJob &job, QStringList *warnings)
+{
+    if (job.isMerge())
+    {
+        return buildMergeArguments(job, warnings);
+    }
+
+    QStringList arguments;
+    if (job.inputDurationLimit > 0.0)
+    {
+        // As an input option this stops decoding early instead of discarding decoded frames
+        arguments << "-t" << QString::number(job.inputDurationLimit, 'f', 3);
+    }
+    // A growing input is fed through stdin by the queue (see GrowingFileFeeder)
+    arguments << "-i" << (job.followGrowingInput ? QString("pipe:0") : job.inputFile);
+
+    arguments << "-vf" << speedVideoFilters(job, warnings).join(",");
+
+    QStringList atempoAudioFilters = generateAtempoFilter(job.speedFactor);
+    if (!atempoAudioFilters.isEmpty())
+    {
+        arguments << "-af" << atempoAudioFilters.join(",");
+    }
+
+    // Machine-readable progress on stdout; the human-readable stats stay on stderr
+    arguments << "-progress" << "pipe:1";
+    arguments << threadArguments(job);
+    arguments << job.encoderArgs;
+    arguments << "-y" << job.outputFile;
+    return arguments;
+}
+
+QStringList buildMergeArguments(const EncodingJob &job, QStringList *warnings)
+{
+    // One graph, one encode: normalize every input to a common canvas, concatenate,
+    // then apply the same speed/overlay chain as a single-file job.
+    const QString width = QString::number(job.canvasWidth);
+    const QString height = QString::number(job.canvasHeight);
+    const QString fps = QString::number(job.canvasFps > 0.0 ? job.canvasFps : 30.0, 'f', 3);
+
+    QStringList arguments;
+    QStringList graph;
+    QString concatInputs;
+    for (int i = 0; i < job.mergeInputs.size(); ++i)
+    {
+        if (job.inputDurationLimit > 0.0)
+        {
+            arguments << "-t" << QString::number(job.inputDurationLimit, 'f', 3);
+        }
+        arguments << "-i" << job.mergeInputs.at(i);
+
+        graph << QString("[%1:v:0]scale=%2:%3:force_original_aspect_ratio=decrease,pad=%2:%3:(ow-iw)/2:(oh-ih)/2,setsar=1,fps=%4,format=yuv420p[v%1]")
+                     .arg(i)
+                     .arg(width, height, fps);
+        if (job.mergeInputHasAudio.value(i))
+        {
+            graph << QString("[%1:a:0]aformat=sample_fmts=fltp:sample_rates=48000:channel_layouts=stereo[a%1]").arg(i);
+        }
+        else
+        {
+            // concat needs an audio segment per input; fill silent clips with silence of the same length
+            double duration = job.mergeInputDurations.value(i);
+            if (job.inputDurationLimit > 0.0)
+                duration = qMin(duration, job.inputDurationLimit);
+            graph << QString("anullsrc=channel_layout=stereo:sample_rate=48000,atrim=duration=%1[a%2]")
+                         .arg(QString::number(duration, 'f', 3))
+                         .arg(i);
+        }
+        concatInputs += QString("[v%1][a%1]").arg(i);
+    }
+    graph << QString("%1concat=n=%2:v=1:a=1[vcat][acat]").arg(concatInputs).arg(job.mergeInputs.size());
+    graph << "[vcat]" + speedVideoFilters(job, warnings).join(",") + "[vout]";
+    graph << "[acat]" + generateAtempoFilter(job.speedFactor).join(",") + "[aout]";
+
+    arguments << "-filter_complex" << graph.join(";");
+    arguments << "-map" << "[vout]" << "-map" << "[aout]";
+    arguments << "-progress" << "pipe:1";
+    arguments << threadArguments(job);
+    arguments << job.encoderArgs;
+    arguments << "-y" << job.outputFile;
+    return arguments;
+}
+
+QString defaultMergeOutputPath(const QStringList &inputFiles, const QString &outputDirectory, double speedFactor)
+{
+    QFileInfo firstInfo(inputFiles.value(0));
+    return QDir(outputDirectory).filePath(QString("%1_merged_x%2.%3")
+                                              .arg(firstInfo.completeBaseName())
+                                              .arg(cleanDoubleString(speedFactor))
+                                              .arg(firstInfo.suffix()));
+}
+
+QStringList threadArguments(const EncodingJob &job)
+{
+    if (job.threads <= 0)
+        return {};
+    // Before encoderArgs, so an explicit "-threads" there still wins.
+    // Merge jobs run a -filter_complex graph, which has its own thread option.
+    const QString threads = QString::number(job.threads);
+    return {"-threads", threads, job.isMerge() ? "-filter_complex_threads" : "-filter_threads", threads};
+}
+
+QStringList generateAtempoFilter(double speedFactor)
+{
+    QStringList atempoFilters;
+    if (speedFactor <= 0.001)
+    {
+        return {"atempo=1.0"};
+    }
+
+    double currentFactor = speedFactor;
+    for (int i = 0; i < 10 && (currentFactor < 0.5 || currentFactor > 2.0); ++i)
+    {
+        if (currentFactor < 0.5)
+        {
+            atempoFilters.append("atempo=0.5");
+            currentFactor /= 0.5;
+        }
+        else
+        {
+            atempoFilters.append("atempo=2.0");
+            currentFactor /= 2.0;
+        }
+    }
+    if (currentFactor >= 0.01 && currentFactor <= 100.0)
+    { // Ensure final factor is somewhat reasonable
+        atempoFilters.append(QString("atempo=%1").arg(QString::number(currentFactor, 'f', 4)));
+    }
+    else if (atempoFilters.isEmpty())
+    {                                       // If loop didn't run, and factor is still bad
+        atempoFilters.append("atempo=1.0"); // Fallback
+    }
+
+    if (atempoFilters.isEmpty())
+    {
+        return {"atempo=1.0"};
+    }
+    return atempoFilters;
+}
+
+} // namespace FfmpegCommand
@@ -0,0 +1,37 @@
+#ifndef _FFMPEG_COMMAND_H
+#define _FFMPEG_COMMAND_H
+
+#include <QString>
+#include <QStringList>
+
+#include "encoding_job.h"
+
+// Helpers that turn an EncodingJob into an ffmpeg command line.
+// Kept free of any widget state so the UI and the job server build identical commands.
+namespace FfmpegCommand
+{
+    // Builds the full argument list (everything after the ffmpeg executable).
+    // Non-fatal problems (e.g. a missing overlay font) are appended to 'warnings'.
+    QStringList buildArguments(const EncodingJob &job, QStringList *warnings = nullptr);
+    // Merge jobs: all inputs in one filter graph (normalize -> concat -> speed/overlay), one encode.
+    // Called by buildArguments(); the job must be prepared (canvas and per-input audio known).
+    QStringList buildMergeArguments(const EncodingJob &job, QStringList *warnings = nullptr);
+
+    // setpts, the optional speed overlay and the optional preview downscale, in that order.
+    QStringList speedVideoFilters(const EncodingJob &job, QStringList *warnings = nullptr);
+
+    QStringList generateAtempoFilter(double speedFactor);
+
+    // "-threads N -filter_threads N" (-filter_complex_threads for merges) for a job pinned to N cores, otherwise nothing.
+    QStringList threadArguments(const EncodingJob &job);
+
+    // "<dir>/<base>_x<speed>.<ext>", the naming scheme used for batch outputs.
+    QString defaultOutputPath(const QString &inputFile, const QString &outputDirectory, double speedFactor);
+    // "<dir>/<first base>_merged_x<speed>.<first ext>"
+    QString defaultMergeOutputPath(const QStringList &inputFiles, const QString &outputDirectory, double speedFactor);
+
+    // Remove trailing zeros and dot from a double string
+    QString cleanDoubleString(double value);
+}
+
+#endif // _FFMPEG_COMMAND_H
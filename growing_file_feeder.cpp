@@ -0,0 +1,262 @@
+#include "growing_file_feeder.h"
+
+#include <QProcess>
+#include <QTimer>
+#include <QSocketNotifier>
+#include <QFileInfo>
+#include <QDir>
+#include <QtEndian>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int POLL_INTERVAL_MS = 250;
+    const qint64 CHUNK_SIZE = 1024 * 1024;
+    const qint64 MAX_BUFFERED_BYTES = 4 * CHUNK_SIZE; // Don't outrun ffmpeg by more than this
+    // Some recorders close and reopen the file (e.g. to rewrite a header); wait a little before trusting a close
+    const int CLOSE_GRACE_MS = 1500;
+    // Fallback end-of-input where closes cannot be watched
+    const int IDLE_TIMEOUT_MS = 30000;
+    const int MAX_LAYOUT_CHECK_BYTES = 1024 * 1024;
+
+#ifdef Q_OS_LINUX
+    // Looks through /proc for a descriptor open for writing on the file. Only sees processes we may inspect.
+    bool hasWriterInProc(const QString &filePath)
+    {
+        const QString target = QFileInfo(filePath).canonicalFilePath();
+        const QDir proc("/proc");
+        for (const QString &pid : proc.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        {
+            if (!pid.at(0).isDigit())
+                continue;
+            const QDir fdDir(proc.filePath(pid + "/fd"));
+            for (const QString &fd : fdDir.entryList(QDir::Files | QDir::System))
+            {
+                if (QFile::symLinkTarget(fdDir.filePath(fd)) != target)
+                    continue;
+                QFile info(proc.filePath(pid + "/fdinfo/" + fd));
+                if (!info.open(QIODevice::ReadOnly))
+                    continue;
+                for (const QByteArray &line : info.readAll().split('\n'))
+                {
+                    bool ok = false;
+                    const int flags = line.startsWith("flags:") ? line.mid(6).trimmed().toInt(&ok, 8) : 0;
+                    if (ok && (flags & O_ACCMODE) != O_RDONLY)
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Whether any process has 'file' open for writing. A read lease is refused exactly then;
+    // where leases are not allowed (not our file, some network filesystems) /proc is searched instead.
+    bool hasWriter(QFile &file, const QString &filePath)
+    {
+        const int fd = file.handle();
+        if (::fcntl(fd, F_SETLEASE, F_RDLCK) == 0)
+        {
+            ::fcntl(fd, F_SETLEASE, F_UNLCK);
+            return false;
+        }
+        if (errno == EAGAIN)
+            return true;
+        return hasWriterInProc(filePath);
+    }
+#endif
+}
+
+GrowingFileFeeder::GrowingFileFeeder(const QString &filePath, QProcess *process, QObject *parent)
+    : QObject(parent), filePath(filePath), process(process), file(filePath), pollTimer(new QTimer(this))
+{
+    pollTimer->setInterval(POLL_INTERVAL_MS);
+    connect(pollTimer, &QTimer::timeout, this, &GrowingFileFeeder::pump);
+    connect(process, &QProcess::bytesWritten, this, &GrowingFileFeeder::pump);
+
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    checkingLayout = suffix == "mp4" || suffix == "m4v" || suffix == "mov";
+}
+
+GrowingFileFeeder::~GrowingFileFeeder()
+{
+    stop();
+}
+
+void GrowingFileFeeder::start()
+{
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    {
+        done = true;
+        emit failed(QString("Could not open '%1': %2").arg(filePath, file.errorString()));
+        return;
+    }
+
+#ifdef Q_OS_LINUX
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd >= 0 && inotify_add_watch(watchFd, QFile::encodeName(filePath).constData(), IN_CLOSE_WRITE) >= 0)
+    {
+        watchNotifier = new QSocketNotifier(watchFd, QSocketNotifier::Read, this);
+        connect(watchNotifier, &QSocketNotifier::activated, this, &GrowingFileFeeder::onWatchEvent);
+    }
+    else if (watchFd >= 0)
+    {
+        ::close(watchFd);
+        watchFd = -1;
+    }
+    // The watch only reports closes from now on: a file nobody is writing is already complete
+    if (watchNotifier && !hasWriter(file, filePath))
+    {
+        writerClosed = true;
+        sizeAtClose = file.size();
+        sinceWriterClosed.start();
+    }
+#endif
+
+    sinceLastData.start();
+    pollTimer->start();
+    pump();
+}
+
+void GrowingFileFeeder::stop()
+{
+    done = true;
+    pollTimer->stop();
+    delete watchNotifier;
+    watchNotifier = nullptr;
+#ifdef Q_OS_LINUX
+    if (watchFd >= 0)
+    {
+        ::close(watchFd);
+        watchFd = -1;
+    }
+#endif
+}
+
+qint64 GrowingFileFeeder::bytesFed() const
+{
+    return fedBytes;
+}
+
+void GrowingFileFeeder::pump()
+{
+    if (done || !file.isOpen())
+        return;
+
+    while (process->bytesToWrite() < MAX_BUFFERED_BYTES)
+    {
+        const QByteArray chunk = file.read(CHUNK_SIZE);
+        if (chunk.isEmpty())
+            break;
+        if (!checkLayout(chunk))
+        {
+            stop();
+            emit failed(QString("'%1' is an MP4 that is not fragmented and cannot be read while it is written. "
+                                "Record to MKV, MPEG-TS or fragmented MP4 instead.")
+                            .arg(QFileInfo(filePath).fileName()));
+            return;
+        }
+        process->write(chunk);
+        fedBytes += chunk.size();
+        sinceLastData.restart();
+    }
+    if (writerClosed && file.size() > sizeAtClose)
+    {
+        // Appended to after the close: the file was reopened
+        writerClosed = false;
+    }
+    if (process->bytesToWrite() > 0 || file.pos() < file.size())
+        return;
+
+    if (writerClosed && sinceWriterClosed.elapsed() >= CLOSE_GRACE_MS)
+    {
+        finish("writer closed the file");
+    }
+    else if (!watchNotifier && sinceLastData.elapsed() >= IDLE_TIMEOUT_MS)
+    {
+        finish(QString("no new data for %1 s").arg(IDLE_TIMEOUT_MS / 1000));
+    }
+}
+
+void GrowingFileFeeder::onWatchEvent()
+{
+#ifdef Q_OS_LINUX
+    alignas(inotify_event) char buffer[4096];
+    bool closed = false;
+    ssize_t length;
+    while ((length = ::read(watchFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *event = buffer; event < buffer + length;)
+        {
+            const auto *notification = reinterpret_cast<const inotify_event *>(event);
+            closed |= (notification->mask & IN_CLOSE_WRITE) != 0;
+            event += sizeof(inotify_event) + notification->len;
+        }
+    }
+    if (closed)
+    {
+        writerClosed = true;
+        sizeAtClose = file.size();
+        sinceWriterClosed.start();
+        pump();
+    }
+#endif
+}
+
+bool GrowingFileFeeder::checkLayout(const QByteArray &chunk)
+{
+    if (!checkingLayout)
+        return true;
+
+    head += chunk;
+    qint64 offset = 0;
+    while (offset + 8 <= head.size())
+    {
+        quint64 size = qFromBigEndian<quint32>(head.constData() + offset);
+        const QByteArray type = head.mid(offset + 4, 4);
+        if (type == "moov" || type == "moof")
+        {
+            checkingLayout = false;
+            head.clear();
+            return true;
+        }
+        if (type == "mdat")
+        {
+            checkingLayout = false;
+            head.clear();
+            return false;
+        }
+        if (size == 1)
+        {
+            if (offset + 16 > head.size())
+                break;
+            size = qFromBigEndian<quint64>(head.constData() + offset + 8);
+        }
+        if (size < 8)
+        {
+            // Box runs to the end of the file, or is garbage: leave it to ffmpeg
+            checkingLayout = false;
+            head.clear();
+            return true;
+        }
+        offset += static_cast<qint64>(size);
+    }
+    if (head.size() > MAX_LAYOUT_CHECK_BYTES)
+    {
+        checkingLayout = false;
+        head.clear();
+    }
+    return true;
+}
+
+void GrowingFileFeeder::finish(const QString &reason)
+{
+    stop();
+    process->closeWriteChannel();
+    emit finished(reason);
+}
@@ -0,0 +1,67 @@
+#ifndef _GROWING_FILE_FEEDER_H
+#define _GROWING_FILE_FEEDER_H
+
+#include <QObject>
+#include <QFile>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE
+class QProcess;
+class QTimer;
+class QSocketNotifier;
+QT_END_NAMESPACE
+
+// Copies a file that is still being written into ffmpeg's stdin, like "tail -f",
+// so a recording can be sped up while it is captured.
+//
+// The end of the input is the writer closing the file (inotify IN_CLOSE_WRITE on Linux; a file
+// no one has open for writing at the start is already complete). Where closes cannot be
+// watched, no new data for a while ends it instead.
+// The input must be readable front to back: MKV, MPEG-TS or fragmented MP4.
+class GrowingFileFeeder : public QObject
+{
+    Q_OBJECT
+
+public:
+    GrowingFileFeeder(const QString &filePath, QProcess *process, QObject *parent = nullptr);
+    ~GrowingFileFeeder() override;
+
+    // Call once the process has started.
+    void start();
+    // Stops feeding without closing stdin, e.g. because the process is gone.
+    void stop();
+
+    qint64 bytesFed() const;
+
+signals:
+    // The input cannot be streamed; the job should be aborted.
+    void failed(const QString &reason);
+    // All data has been handed to ffmpeg and its stdin is closed.
+    void finished(const QString &reason);
+
+private:
+    void pump();
+    void onWatchEvent();
+    bool checkLayout(const QByteArray &chunk);
+    void finish(const QString &reason);
+
+    QString filePath;
+    QProcess *process;
+    QFile file;
+    QTimer *pollTimer;
+    QElapsedTimer sinceLastData;
+    QElapsedTimer sinceWriterClosed;
+    bool writerClosed = false;
+    qint64 sizeAtClose = 0;
+    bool done = false;
+    qint64 fedBytes = 0;
+
+    // MP4/MOV: 'moov' must come before 'mdat', otherwise nothing is decodable until the end
+    bool checkingLayout = false;
+    QByteArray head;
+
+    int watchFd = -1;
+    QSocketNotifier *watchNotifier = nullptr;
+};
+
+#endif // _GROWING_FILE_FEEDER_H
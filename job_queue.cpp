@@ -0,0 +1,729 @@
+#include "job_queue.h"
+
+#include <QDebug>
+#include <QFileInfo>
+
+#include "ffmpeg_command.h"
+#include "growing_file_feeder.h"
+
+const QString JobQueue::LocalNode = "local";
+
+JobQueue::JobQueue(QObject *parent)
+    : QObject(parent), prober(new MediaProber(this))
+{
+    connect(prober, &MediaProber::probed, this, &JobQueue::onProbed);
+}
+
+JobQueue::~JobQueue()
+{
+    for (QProcess *process : std::as_const(runningProcesses))
+    {
+        process->disconnect();
+        if (process->state() != QProcess::NotRunning)
+        {
+            process->kill();
+            process->waitForFinished(1000);
+        }
+        delete process;
+    }
+    runningProcesses.clear();
+}
+
+void JobQueue::setFfmpegPath(const QString &path)
+{
+    ffmpegExecutable = path;
+    prober->setFfmpegPath(path);
+}
+
+QString JobQueue::ffmpegPath() const
+{
+    return ffmpegExecutable;
+}
+
+void JobQueue::setMaxConcurrentJobs(int count)
+{
+    maxLocalJobs = qMax(0, count);
+    reconsiderExcludedJobs();
+    QMetaObject::invokeMethod(this, &JobQueue::startPendingJobs, Qt::QueuedConnection);
+}
+
+int JobQueue::maxConcurrentJobs() const
+{
+    return maxLocalJobs;
+}
+
+void JobQueue::setOrderingPolicy(OrderingPolicy policy)
+{
+    if (policy == ordering)
+        return;
+    ordering = policy;
+
+    // Re-key everything that is still waiting; O(n log n) once per policy change
+    const QList<int> ids = pendingKeys.keys();
+    for (int id : ids)
+    {
+        repositionPending(id);
+        if (ordering != OrderingPolicy::Fifo)
+            requestDuration(id);
+    }
+}
+
+JobQueue::OrderingPolicy JobQueue::orderingPolicy() const
+{
+    return ordering;
+}
+
+bool JobQueue::setPriority(int id, int priority)
+{
+    auto it = jobTable.find(id);
+    if (it == jobTable.end())
+        return false;
+    it->priority = priority;
+    if (pendingKeys.contains(id))
+        repositionPending(id);
+    return true;
+}
+
+void JobQueue::setPlacementPolicy(PlacementPolicy policy)
+{
+    placement = policy;
+    if (placement != PlacementPolicy::None && topology.isEmpty())
+    {
+        topology = CpuTopology::detect();
+    }
+}
+
+JobQueue::PlacementPolicy JobQueue::placementPolicy() const
+{
+    return placement;
+}
+
+void JobQueue::setMaxRetainedJobs(int count)
+{
+    maxRetained = qMax(0, count);
+    evictFinishedJobs();
+}
+
+int JobQueue::maxRetainedJobs() const
+{
+    return maxRetained;
+}
+
+int JobQueue::enqueue(EncodingJob job)
+{
+    job.id = nextJobId++;
+    job.state = EncodingJob::State::Queued;
+    job.exitCode = 0;
+    job.errorString.clear();
+    job.inputSize = QFileInfo(job.inputFile).size();
+    if (job.isMerge())
+    {
+        job.followGrowingInput = false;
+    }
+
+    const int id = job.id;
+    jobTable.insert(id, job);
+    if (job.isMerge() && !job.isMergePrepared())
+    {
+        emit jobQueued(id);
+        prepareMerge(id);
+        return id;
+    }
+    if (job.followGrowingInput && maxLocalJobs == 0)
+    {
+        // Followed inputs never go to remote nodes, so without local slots the job could never start
+        QMetaObject::invokeMethod(this, [this, id]()
+                                  {
+            auto it = jobTable.constFind(id);
+            if (it == jobTable.constEnd() || it->state != EncodingJob::State::Queued)
+                return;
+            finishJob(id, EncodingJob::State::Failed, 0, "Following a growing input needs a local encoding slot");
+            emitIdleIfDone(); }, Qt::QueuedConnection);
+        return id;
+    }
+    addPending(id);
+    if (ordering != OrderingPolicy::Fifo)
+        requestDuration(id);
+    emit jobQueued(id);
+
+    // Start from the event loop so callers can record the id before any job signal fires
+    QMetaObject::invokeMethod(this, &JobQueue::startPendingJobs, Qt::QueuedConnection);
+    return id;
+}
+
+bool JobQueue::cancel(int id)
+{
+    auto it = jobTable.find(id);
+    if (it == jobTable.end())
+        return false;
+
+    if (it->state == EncodingJob::State::Queued)
+    {
+        removePending(id);
+        preparingJobIds.remove(id);
+        mergeProbes.remove(id);
+        finishJob(id, EncodingJob::State::Cancelled, 0, "Cancelled before start");
+        emitIdleIfDone();
+        return true;
+    }
+    if (it->state == EncodingJob::State::Running)
+    {
+        if (claimedJobIds.contains(id))
+        {
+            cancelRequested.insert(id);
+            emit remoteCancelRequested(id, it->assignedNode);
+            return true;
+        }
+        QProcess *process = runningProcesses.value(id);
+        if (!process)
+            return false;
+        cancelRequested.insert(id);
+        process->kill(); // onProcessFinished() marks the job as cancelled
+        return true;
+    }
+    return false;
+}
+
+std::optional<EncodingJob> JobQueue::job(int id) const
+{
+    auto it = jobTable.constFind(id);
+    if (it == jobTable.constEnd())
+        return std::nullopt;
+    return *it;
+}
+
+QList<EncodingJob> JobQueue::jobs() const
+{
+    return jobTable.values();
+}
+
+int JobQueue::pendingCount() const
+{
+    return static_cast<int>(pendingJobs.size());
+}
+
+int JobQueue::runningCount() const
+{
+    return runningProcesses.size() + claimedJobIds.size();
+}
+
+bool JobQueue::isIdle() const
+{
+    return pendingJobs.empty() && preparingJobIds.isEmpty() && runningProcesses.isEmpty() && claimedJobIds.isEmpty();
+}
+
+std::optional<EncodingJob> JobQueue::claimJob(const QString &node)
+{
+    const int id = takeNextPendingFor(node);
+    if (id == 0)
+        return std::nullopt;
+
+    EncodingJob &job = jobTable[id];
+    job.state = EncodingJob::State::Running;
+    job.assignedNode = node;
+    job.attempts++;
+    claimedJobIds.insert(id);
+
+    emit jobStarted(id, FfmpegCommand::buildArguments(job));
+    return job;
+}
+
+void JobQueue::updateJobProgress(int id, double progressSeconds, double fps)
+{
+    auto it = jobTable.find(id);
+    if (it == jobTable.end() || it->state != EncodingJob::State::Running)
+        return;
+    it->progressSeconds = progressSeconds;
+    it->fps = fps;
+    emit jobProgress(id);
+}
+
+void JobQueue::completeClaimedJob(int id, EncodingJob::State state, int exitCode, const QString &errorString)
+{
+    if (!claimedJobIds.remove(id))
+        return;
+
+    if (cancelRequested.remove(id))
+    {
+        state = EncodingJob::State::Cancelled;
+    }
+    finishJob(id, state, exitCode, errorString);
+    startPendingJobs();
+    emitIdleIfDone();
+}
+
+void JobQueue::failClaimedJob(int id, const QString &node, int exitCode, const QString &reason)
+{
+    if (!claimedJobIds.remove(id))
+        return;
+
+    if (cancelRequested.remove(id))
+    {
+        finishJob(id, EncodingJob::State::Cancelled, exitCode, reason);
+    }
+    else if (!retryElsewhere(id, node, reason))
+    {
+        finishJob(id, EncodingJob::State::Failed, exitCode, reason);
+    }
+    startPendingJobs();
+    emitIdleIfDone();
+}
+
+void JobQueue::setMaxAttempts(int attempts)
+{
+    attemptLimit = qMax(1, attempts);
+}
+
+int JobQueue::maxAttempts() const
+{
+    return attemptLimit;
+}
+
+void JobQueue::setRemoteNodes(const QStringList &nodes)
+{
+    remoteNodes = nodes;
+    reconsiderExcludedJobs();
+}
+
+void JobQueue::reconsiderExcludedJobs()
+{
+    // Eligibility was checked when these jobs failed; the nodes they were requeued for may be gone since
+    bool failedAny = false;
+    const QList<int> ids = pendingKeys.keys();
+    for (int id : ids)
+    {
+        EncodingJob &job = jobTable[id];
+        if (job.excludedNodes.isEmpty() || hasOtherEligibleNode(job, QString()))
+            continue;
+
+        if (maxLocalJobs > 0 && job.excludedNodes.removeAll(LocalNode) > 0)
+        {
+            emit jobLog(id, QString("Job #%1 has no other node left to retry on; retrying on this host.").arg(id));
+            continue;
+        }
+        removePending(id);
+        finishJob(id, EncodingJob::State::Failed, job.exitCode, QString("No node left to retry on after failing on %1").arg(job.excludedNodes.join(", ")));
+        failedAny = true;
+    }
+    if (failedAny)
+        emitIdleIfDone();
+    QMetaObject::invokeMethod(this, &JobQueue::startPendingJobs, Qt::QueuedConnection);
+}
+
+bool JobQueue::retryElsewhere(int id, const QString &failedNode, const QString &reason)
+{
+    const EncodingJob &job = *jobTable.constFind(id);
+    if (job.attempts >= attemptLimit || !hasOtherEligibleNode(job, failedNode))
+        return false;
+    requeueJob(id, failedNode, reason);
+    return true;
+}
+
+bool JobQueue::hasOtherEligibleNode(const EncodingJob &job, const QString &failedNode) const
+{
+    QStringList excluded = job.excludedNodes;
+    excluded << failedNode;
+
+    if (maxLocalJobs > 0 && !excluded.contains(LocalNode))
+        return true;
+    if (job.followGrowingInput)
+        return false; // Never handed to remote nodes
+    for (const QString &node : remoteNodes)
+    {
+        if (!excluded.contains(node))
+            return true;
+    }
+    return false;
+}
+
+void JobQueue::requeueJob(int id, const QString &failedNode, const QString &reason)
+{
+    EncodingJob &job = jobTable[id];
+    job.state = EncodingJob::State::Queued;
+    job.assignedNode.clear();
+    job.progressSeconds = 0.0;
+    job.fps = 0.0;
+    if (!job.excludedNodes.contains(failedNode))
+    {
+        job.excludedNodes << failedNode;
+    }
+    addPending(id, true);
+
+    emit jobLog(id, QString("Job #%1 failed on %2 (%3); queued for retry on another node.").arg(id).arg(failedNode, reason));
+    emit jobQueued(id);
+    QMetaObject::invokeMethod(this, &JobQueue::startPendingJobs, Qt::QueuedConnection);
+}
+
+void JobQueue::addPending(int id, bool atFront)
+{
+    const EncodingJob &job = *jobTable.constFind(id);
+    const PendingKey key{job.priority, orderingCost(job), atFront ? --frontSequence : nextSequence++, id};
+    pendingJobs.insert(key);
+    pendingKeys.insert(id, key);
+}
+
+void JobQueue::removePending(int id)
+{
+    auto it = pendingKeys.find(id);
+    if (it == pendingKeys.end())
+        return;
+    pendingJobs.erase(*it);
+    pendingKeys.erase(it);
+    awaitingDuration.remove(jobTable.constFind(id)->inputFile, id);
+}
+
+void JobQueue::repositionPending(int id)
+{
+    auto it = pendingKeys.find(id);
+    if (it == pendingKeys.end())
+        return;
+    pendingJobs.erase(*it);
+    const EncodingJob &job = *jobTable.constFind(id);
+    it->priority = job.priority;
+    it->cost = orderingCost(job);
+    pendingJobs.insert(*it);
+}
+
+double JobQueue::orderingCost(const EncodingJob &job) const
+{
+    if (ordering == OrderingPolicy::Fifo)
+        return 0.0;
+
+    // Until the probe answers, estimate the duration from the file size
+    const double duration = job.durationSeconds > 0.0 ? job.durationSeconds
+                                                       : job.inputSize / bytesPerSecondEstimate;
+    return ordering == OrderingPolicy::ShortestFirst ? duration : -duration;
+}
+
+void JobQueue::requestDuration(int id)
+{
+    const EncodingJob &job = *jobTable.constFind(id);
+    // A file still being written has no final duration yet
+    if (job.followGrowingInput || job.durationSeconds > 0.0 || awaitingDuration.contains(job.inputFile, id))
+        return;
+    awaitingDuration.insert(job.inputFile, id);
+    prober->probe(job.inputFile);
+}
+
+void JobQueue::prepareMerge(int id)
+{
+    preparingJobIds.insert(id);
+    const EncodingJob &job = *jobTable.constFind(id);
+    QHash<QString, MediaInfo> &probes = mergeProbes[id];
+    for (const QString &input : job.mergeInputs)
+    {
+        MediaInfo info;
+        if (prober->cachedInfo(input, &info))
+        {
+            probes.insert(input, info);
+        }
+        else if (!awaitingMergeProbe.contains(input, id))
+        {
+            awaitingMergeProbe.insert(input, id);
+            prober->probe(input);
+        }
+    }
+    tryCompleteMerge(id);
+}
+
+void JobQueue::tryCompleteMerge(int id)
+{
+    if (!preparingJobIds.contains(id))
+        return;
+
+    // Uses the results kept for this job, not the prober's cache: an input that changes after
+    // its probe (e.g. one still being written) would otherwise never count as probed
+    const QHash<QString, MediaInfo> &probes = mergeProbes[id];
+    QList<MediaInfo> infos;
+    for (const QString &input : jobTable.constFind(id)->mergeInputs)
+    {
+        auto probe = probes.constFind(input);
+        if (probe == probes.constEnd())
+            return; // Its probe is still outstanding
+        const MediaInfo &info = *probe;
+        if (!info.valid || info.width <= 0)
+        {
+            preparingJobIds.remove(id);
+            mergeProbes.remove(id);
+            finishJob(id, EncodingJob::State::Failed, 0, QString("Could not read video stream of '%1' for merging").arg(input));
+            emitIdleIfDone();
+            return;
+        }
+        infos << info;
+    }
+
+    // The first clip defines the canvas; the others are letterboxed into it
+    EncodingJob &job = jobTable[id];
+    job.canvasWidth = infos.first().width & ~1;
+    job.canvasHeight = infos.first().height & ~1;
+    job.canvasFps = infos.first().frameRate > 0.0 ? infos.first().frameRate : 30.0;
+    job.mergeInputHasAudio.clear();
+    job.mergeInputDurations.clear();
+    job.durationSeconds = 0.0;
+    job.inputSize = 0;
+    for (int i = 0; i < infos.size(); ++i)
+    {
+        job.mergeInputHasAudio << infos.at(i).hasAudio;
+        job.mergeInputDurations << infos.at(i).durationSeconds;
+        job.durationSeconds += infos.at(i).durationSeconds;
+        job.inputSize += QFileInfo(job.mergeInputs.at(i)).size();
+    }
+
+    preparingJobIds.remove(id);
+    mergeProbes.remove(id);
+    addPending(id);
+    emit jobQueued(id);
+    QMetaObject::invokeMethod(this, &JobQueue::startPendingJobs, Qt::QueuedConnection);
+}
+
+void JobQueue::onProbed(const QString &filePath, const MediaInfo &info)
+{
+    const QList<int> mergeIds = awaitingMergeProbe.values(filePath);
+    awaitingMergeProbe.remove(filePath);
+    for (int id : mergeIds)
+    {
+        if (!preparingJobIds.contains(id))
+            continue;
+        mergeProbes[id].insert(filePath, info);
+        tryCompleteMerge(id);
+    }
+
+    const QList<int> ids = awaitingDuration.values(filePath);
+    awaitingDuration.remove(filePath);
+    if (!info.valid)
+        return;
+
+    probedBytes += QFileInfo(filePath).size();
+    probedSeconds += info.durationSeconds;
+    if (probedBytes > 0.0 && probedSeconds > 0.0)
+        bytesPerSecondEstimate = probedBytes / probedSeconds;
+
+    for (int id : ids)
+    {
+        auto it = jobTable.find(id);
+        if (it == jobTable.end())
+            continue;
+        it->durationSeconds = info.durationSeconds;
+        repositionPending(id);
+    }
+}
+
+int JobQueue::takeNextPendingFor(const QString &node)
+{
+    for (auto it = pendingJobs.begin(); it != pendingJobs.end(); ++it)
+    {
+        const int id = it->id;
+        const EncodingJob &job = *jobTable.constFind(id);
+        if (!job.excludedNodes.contains(node) && (node == LocalNode || !job.followGrowingInput))
+        {
+            pendingJobs.erase(it);
+            pendingKeys.remove(id);
+            awaitingDuration.remove(job.inputFile, id);
+            return id;
+        }
+    }
+    return 0;
+}
+
+void JobQueue::startPendingJobs()
+{
+    while (runningProcesses.size() < maxLocalJobs)
+    {
+        const int id = takeNextPendingFor(LocalNode);
+        if (id == 0)
+            break;
+        startJob(id);
+    }
+}
+
+void JobQueue::startJob(int id)
+{
+    EncodingJob &job = jobTable[id];
+    job.state = EncodingJob::State::Running;
+    job.assignedNode = LocalNode;
+    job.attempts++;
+
+    QProcess *process = new QProcess(this);
+    applyPlacement(id, process);
+
+    QStringList warnings;
+    const QStringList arguments = FfmpegCommand::buildArguments(job, &warnings);
+    for (const QString &warning : warnings)
+    {
+        emit jobLog(id, warning);
+    }
+
+    process->setReadChannel(QProcess::StandardOutput);
+    runningProcesses.insert(id, process);
+
+    connect(process, &QProcess::finished, this, [this, id](int exitCode, QProcess::ExitStatus exitStatus)
+            { onProcessFinished(id, exitCode, exitStatus); });
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, id, process]()
+            { readProgress(id, process); });
+    connect(process, &QProcess::readyReadStandardError, this, [this, id, process]()
+            {
+        QString text = QString::fromLocal8Bit(process->readAllStandardError()).trimmed();
+        qDebug().noquote() << "FFMPEG_STDERR:" << text;
+        emit jobLog(id, text); });
+    connect(process, &QProcess::errorOccurred, this, [this, id, process](QProcess::ProcessError error)
+            {
+        emit jobLog(id, QString("FFmpeg process error: %1 for file %2. FFmpeg error string: %3")
+                            .arg(static_cast<int>(error))
+                            .arg(QFileInfo(jobTable.value(id).inputFile).fileName())
+                            .arg(process->errorString()));
+        // finished() is not emitted when the process never started
+        if (error == QProcess::FailedToStart)
+        {
+            onProcessFinished(id, -1, QProcess::CrashExit);
+        } });
+
+    if (job.followGrowingInput)
+    {
+        GrowingFileFeeder *feeder = new GrowingFileFeeder(job.inputFile, process, process);
+        connect(process, &QProcess::started, feeder, &GrowingFileFeeder::start);
+        connect(feeder, &GrowingFileFeeder::finished, this, [this, id, feeder](const QString &reason)
+                { emit jobLog(id, QString("Input ended after %1 MiB (%2); finalizing output.")
+                                      .arg(feeder->bytesFed() / (1024.0 * 1024.0), 0, 'f', 1)
+                                      .arg(reason)); });
+        connect(feeder, &GrowingFileFeeder::failed, this, [this, id, process](const QString &reason)
+                {
+            abortReasons.insert(id, reason);
+            process->kill(); });
+    }
+
+    emit jobStarted(id, arguments);
+    qDebug() << "Starting ffmpeg with:" << ffmpegExecutable << arguments;
+    process->start(ffmpegExecutable, arguments);
+}
+
+void JobQueue::applyPlacement(int id, QProcess *process)
+{
+    EncodingJob &job = jobTable[id];
+    job.threads = 0;
+    if (placement == PlacementPolicy::None || topology.isEmpty())
+        return;
+
+    // Lowest slot no running job holds; one is always free below maxLocalJobs
+    int slot = 0;
+    const QList<int> usedSlots = placementSlots.values();
+    while (usedSlots.contains(slot))
+        ++slot;
+    const CpuSet cpuSet = topology.partition(maxLocalJobs).value(slot);
+    if (cpuSet.cpus.isEmpty())
+        return;
+
+    const bool bindMemory = placement == PlacementPolicy::PinCoresAndMemory && cpuSet.node >= 0;
+#ifdef Q_OS_UNIX
+    process->setChildProcessModifier(CpuTopology::childModifier(cpuSet, bindMemory));
+#endif
+    placementSlots.insert(id, slot);
+    job.threads = cpuSet.cpus.size();
+
+    QString text = QString("Placed on CPUs %1").arg(CpuTopology::formatCpuList(cpuSet.cpus));
+    if (cpuSet.node >= 0)
+        text += QString(" (NUMA node %1%2)").arg(cpuSet.node).arg(bindMemory ? ", memory bound" : "");
+    emit jobLog(id, text);
+}
+
+void JobQueue::readProgress(int id, QProcess *process)
+{
+    // stdout carries "-progress pipe:1" blocks: key=value lines terminated by progress=continue|end
+    EncodingJob &job = jobTable[id];
+    while (process->canReadLine())
+    {
+        const QByteArray line = process->readLine().trimmed();
+        const int separator = line.indexOf('=');
+        if (separator <= 0)
+        {
+            if (!line.isEmpty())
+                emit jobLog(id, QString::fromUtf8(line));
+            continue;
+        }
+
+        const QByteArray key = line.left(separator);
+        const QByteArray value = line.mid(separator + 1);
+        if (key == "out_time_us" || key == "out_time_ms") // Both are microseconds
+        {
+            job.progressSeconds = value.toDouble() / 1000000.0;
+        }
+        else if (key == "fps")
+        {
+            job.fps = value.toDouble();
+        }
+        else if (key == "progress")
+        {
+            emit jobProgress(id);
+        }
+    }
+}
+
+void JobQueue::onProcessFinished(int id, int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QProcess *process = runningProcesses.take(id);
+    if (!process)
+        return;
+
+    readProgress(id, process);
+    const QString errorString = process->errorString();
+    process->disconnect();
+    if (GrowingFileFeeder *feeder = process->findChild<GrowingFileFeeder *>())
+    {
+        feeder->stop();
+    }
+    process->deleteLater();
+    placementSlots.remove(id);
+
+    if (cancelRequested.remove(id))
+    {
+        abortReasons.remove(id);
+        finishJob(id, EncodingJob::State::Cancelled, exitCode, "Cancelled while running");
+    }
+    else if (abortReasons.contains(id))
+    {
+        finishJob(id, EncodingJob::State::Failed, -1, abortReasons.take(id));
+    }
+    else if (exitStatus == QProcess::CrashExit || exitCode != 0)
+    {
+        const int code = exitStatus == QProcess::CrashExit ? -1 : exitCode;
+        if (!retryElsewhere(id, LocalNode, code == -1 ? errorString : QString("exit code %1").arg(code)))
+            finishJob(id, EncodingJob::State::Failed, code, errorString);
+    }
+    else
+    {
+        finishJob(id, EncodingJob::State::Finished, 0, QString());
+    }
+
+    startPendingJobs();
+    emitIdleIfDone();
+}
+
+void JobQueue::finishJob(int id, EncodingJob::State state, int exitCode, const QString &errorString)
+{
+    EncodingJob &job = jobTable[id];
+    job.state = state;
+    job.exitCode = exitCode;
+    job.errorString = errorString;
+    emit jobFinished(id);
+
+    finishedJobIds.append(id);
+    evictFinishedJobs();
+}
+
+void JobQueue::evictFinishedJobs()
+{
+    while (finishedJobIds.size() > maxRetained)
+    {
+        const int id = finishedJobIds.takeFirst();
+        jobTable.remove(id);
+        cancelRequested.remove(id);
+        abortReasons.remove(id);
+    }
+}
+
+void JobQueue::emitIdleIfDone()
+{
+    if (isIdle())
+    {
+        emit idle();
+    }
+}
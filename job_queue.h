@@ -0,0 +1,188 @@
+#ifndef _JOB_QUEUE_H
+#define _JOB_QUEUE_H
+
+#include <QObject>
+#include <QProcess>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QList>
+
+#include <optional>
+#include <set>
+
+#include "encoding_job.h"
+#include "media_prober.h"
+#include "cpu_topology.h"
+
+// Headless job queue shared by everything that wants to run ffmpeg:
+// the widget's batch button and the local job server both submit here,
+// so one instance owns a single queue instead of each producer keeping its own.
+//
+// Jobs run either on local ffmpeg processes (up to maxConcurrentJobs at a time)
+// or are claimed by a remote node (see Coordinator), which reports back through
+// updateJobProgress() / completeClaimedJob() / failClaimedJob().
+class JobQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class OrderingPolicy
+    {
+        Fifo,          // Submission order
+        ShortestFirst, // Minimizes mean time to completion
+        LongestFirst   // Minimizes makespan when several jobs run in parallel
+    };
+
+    enum class PlacementPolicy
+    {
+        None,             // The OS scheduler decides
+        PinCores,         // Each local job gets its own core set on one NUMA node
+        PinCoresAndMemory // ... and allocates only from that node's memory
+    };
+
+    static const QString LocalNode;
+
+    explicit JobQueue(QObject *parent = nullptr);
+    ~JobQueue() override;
+
+    void setFfmpegPath(const QString &path);
+    QString ffmpegPath() const;
+
+    // Number of jobs run on this host at once. 0 leaves all work to remote nodes.
+    void setMaxConcurrentJobs(int count);
+    int maxConcurrentJobs() const;
+
+    // Pinned jobs (higher priority) always go first; the policy orders jobs of equal priority.
+    void setOrderingPolicy(OrderingPolicy policy);
+    OrderingPolicy orderingPolicy() const;
+    bool setPriority(int id, int priority);
+
+    // Splits this host's CPUs into maxConcurrentJobs core sets and runs each local ffmpeg
+    // on one of them, with matching thread counts. Only effective on Linux; applies to jobs started later.
+    void setPlacementPolicy(PlacementPolicy policy);
+    PlacementPolicy placementPolicy() const;
+
+    // Finished, failed and cancelled jobs kept for job()/jobs(); older ones are forgotten
+    // once jobFinished() has been handled, so a long-running service does not grow without bound.
+    void setMaxRetainedJobs(int count);
+    int maxRetainedJobs() const;
+
+    // Takes ownership of the job parameters, assigns an id and returns it.
+    // Merge jobs are probed first and only become runnable once every input is known.
+    int enqueue(EncodingJob job);
+    // Removes a queued job or kills a running one. Returns false if the job is unknown or already done.
+    bool cancel(int id);
+
+    std::optional<EncodingJob> job(int id) const;
+    QList<EncodingJob> jobs() const;
+
+    int pendingCount() const;
+    int runningCount() const;
+    bool isIdle() const;
+
+    // Remote execution: hands the next pending job that has not already failed on 'node' to that node.
+    // Jobs that follow a growing input are never handed out; the file is only complete here.
+    std::optional<EncodingJob> claimJob(const QString &node);
+    void updateJobProgress(int id, double progressSeconds, double fps);
+    void completeClaimedJob(int id, EncodingJob::State state, int exitCode, const QString &errorString);
+    // A claimed job failed on 'node': retried on another node while attempts remain, otherwise Failed.
+    // Local failures take the same path.
+    void failClaimedJob(int id, const QString &node, int exitCode, const QString &reason);
+
+    // Total runs per job, local and remote, before a failure is final.
+    void setMaxAttempts(int attempts);
+    int maxAttempts() const;
+    // Remote nodes that can take jobs right now; kept up to date by the Coordinator.
+    // Retried jobs left without any node they may run on are put back on this host, or failed.
+    void setRemoteNodes(const QStringList &nodes);
+
+signals:
+    // Emitted when a job enters the queue, and again when a merge job has been probed
+    // or a failed remote job is put back, i.e. whenever there may be new work to hand out.
+    void jobQueued(int id);
+    void jobStarted(int id, const QStringList &arguments);
+    void jobProgress(int id);
+    // Emitted once per job when it ends as Finished, Failed or Cancelled.
+    void jobFinished(int id);
+    void jobLog(int id, const QString &text);
+    // A job claimed by 'node' should be stopped there; the node reports the outcome as usual.
+    void remoteCancelRequested(int id, const QString &node);
+    // No queued or running jobs left.
+    void idle();
+
+private:
+    // Ordered pending set: O(log n) insert, removal and reprioritization on large queues.
+    struct PendingKey
+    {
+        int priority;
+        double cost;
+        qint64 sequence;
+        int id;
+        bool operator<(const PendingKey &other) const
+        {
+            if (priority != other.priority)
+                return priority > other.priority;
+            if (cost != other.cost)
+                return cost < other.cost;
+            return sequence < other.sequence;
+        }
+    };
+
+    void addPending(int id, bool atFront = false);
+    void removePending(int id);
+    void repositionPending(int id);
+    double orderingCost(const EncodingJob &job) const;
+    void requestDuration(int id);
+    void prepareMerge(int id);
+    void tryCompleteMerge(int id);
+    void onProbed(const QString &filePath, const MediaInfo &info);
+
+    void startPendingJobs();
+    void startJob(int id);
+    int takeNextPendingFor(const QString &node);
+    void applyPlacement(int id, QProcess *process);
+    void readProgress(int id, QProcess *process);
+    void onProcessFinished(int id, int exitCode, QProcess::ExitStatus exitStatus);
+    void finishJob(int id, EncodingJob::State state, int exitCode, const QString &errorString);
+    bool retryElsewhere(int id, const QString &failedNode, const QString &reason);
+    bool hasOtherEligibleNode(const EncodingJob &job, const QString &failedNode) const;
+    void requeueJob(int id, const QString &failedNode, const QString &reason);
+    void reconsiderExcludedJobs();
+    void evictFinishedJobs();
+    void emitIdleIfDone();
+
+    QString ffmpegExecutable = "ffmpeg";
+    int nextJobId = 1;
+    int maxLocalJobs = 1;
+    int attemptLimit = 3;
+    QStringList remoteNodes;
+
+    OrderingPolicy ordering = OrderingPolicy::Fifo;
+    MediaProber *prober;
+    double bytesPerSecondEstimate = 1000000.0; // Until probes say otherwise, ~8 Mbit/s
+    qint64 nextSequence = 0;
+    qint64 frontSequence = 0;
+    double probedBytes = 0.0;
+    double probedSeconds = 0.0;
+    QMultiHash<QString, int> awaitingDuration; // Input path -> pending jobs waiting for its probe
+    QMultiHash<QString, int> awaitingMergeProbe; // Input path -> merge jobs that cannot start without it
+    QSet<int> preparingJobIds;                   // Merge jobs not runnable yet
+    QHash<int, QHash<QString, MediaInfo>> mergeProbes; // Probe results gathered for each preparing merge
+
+    QMap<int, EncodingJob> jobTable;
+    QList<int> finishedJobIds; // Oldest first
+    int maxRetained = 1000;
+    std::set<PendingKey> pendingJobs;
+    QHash<int, PendingKey> pendingKeys;
+    QHash<int, QProcess *> runningProcesses;
+    QSet<int> claimedJobIds; // Running on a remote node
+    QSet<int> cancelRequested;
+    QHash<int, QString> abortReasons; // Local jobs killed for a reason other than cancel()
+
+    PlacementPolicy placement = PlacementPolicy::None;
+    CpuTopology topology; // Detected when placement is first enabled
+    QHash<int, int> placementSlots; // Running local job -> index into topology.partition(maxLocalJobs)
+};
+
+#endif // _JOB_QUEUE_H
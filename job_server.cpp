@@ -0,0 +1,201 @@
+#include "job_server.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+#include "job_queue.h"
+#include "ffmpeg_command.h"
+
+namespace
+{
+    // Far above any real request; a client past this without a newline is dropped
+    const qint64 MAX_LINE_BYTES = 1024 * 1024;
+
+    QJsonObject errorReply(const QString &message)
+    {
+        return QJsonObject{{"ok", false}, {"error", message}};
+    }
+}
+
+QString JobServer::defaultServerName()
+{
+    return "video_speed_changer_jobs";
+}
+
+JobServer::JobServer(JobQueue *queue, QObject *parent)
+    : QObject(parent), server(new QLocalServer(this)), queue(queue)
+{
+    // Only the user running the service may submit jobs
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(server, &QLocalServer::newConnection, this, &JobServer::onNewConnection);
+}
+
+JobServer::~JobServer()
+{
+    server->close();
+}
+
+bool JobServer::listen(const QString &name)
+{
+    // A live server answering on the name means another instance is the host-wide service.
+    // Anything else is a stale socket left behind by a crashed instance.
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(200))
+    {
+        probe.disconnectFromServer();
+        lastError = QString("Another instance is already serving jobs on '%1'.").arg(name);
+        return false;
+    }
+    QLocalServer::removeServer(name);
+
+    if (!server->listen(name))
+    {
+        lastError = server->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool JobServer::isListening() const
+{
+    return server->isListening();
+}
+
+QString JobServer::serverName() const
+{
+    return server->fullServerName();
+}
+
+QString JobServer::errorString() const
+{
+    return lastError;
+}
+
+void JobServer::onNewConnection()
+{
+    while (QLocalSocket *socket = server->nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]()
+                { onReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+void JobServer::onReadyRead(QLocalSocket *socket)
+{
+    while (socket->canReadLine())
+    {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+        QJsonObject reply;
+        if (parseError.error != QJsonParseError::NoError || !document.isObject())
+        {
+            reply = errorReply("Malformed request: " + parseError.errorString());
+        }
+        else
+        {
+            reply = handleRequest(document.object());
+        }
+        socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact) + "\n");
+    }
+    if (socket->bytesAvailable() > MAX_LINE_BYTES)
+    {
+        qDebug() << "JobServer: dropping a client after an overlong request";
+        socket->abort();
+    }
+}
+
+QJsonObject JobServer::handleRequest(const QJsonObject &request)
+{
+    const QString cmd = request.value("cmd").toString();
+    if (cmd == "submit")
+    {
+        return handleSubmit(request);
+    }
+    if (cmd == "status")
+    {
+        const auto job = queue->job(request.value("id").toInt());
+        if (!job)
+            return errorReply("Unknown job id");
+        return QJsonObject{{"ok", true}, {"job", encodingJobToJson(*job)}};
+    }
+    if (cmd == "list")
+    {
+        QJsonArray jobs;
+        for (const EncodingJob &job : queue->jobs())
+        {
+            jobs.append(encodingJobToJson(job));
+        }
+        return QJsonObject{{"ok", true}, {"jobs", jobs}};
+    }
+    if (cmd == "cancel")
+    {
+        if (!queue->cancel(request.value("id").toInt()))
+            return errorReply("Job is unknown or already finished");
+        return QJsonObject{{"ok", true}};
+    }
+    if (cmd == "priority")
+    {
+        const int id = request.value("id").toInt();
+        const auto job = queue->job(id);
+        if (!job || job->state != EncodingJob::State::Queued)
+            return errorReply("Job is unknown or no longer queued");
+        queue->setPriority(id, request.value("priority").toInt());
+        return QJsonObject{{"ok", true}};
+    }
+    return errorReply(QString("Unknown command '%1'").arg(cmd));
+}
+
+QJsonObject JobServer::handleSubmit(const QJsonObject &request)
+{
+    EncodingJob job = encodingJobFromJson(request);
+    job.origin = "ipc";
+    // Filled in by the queue from its own probes, or only meaningful to previews; never the client's word
+    job.mergeInputHasAudio.clear();
+    job.mergeInputDurations.clear();
+    job.canvasWidth = 0;
+    job.canvasHeight = 0;
+    job.canvasFps = 0.0;
+    job.inputDurationLimit = 0.0;
+    job.scaleHeight = 0;
+
+    QFileInfo inputInfo(job.inputFile);
+    if (job.inputFile.isEmpty() || !inputInfo.exists() || !inputInfo.isFile())
+        return errorReply(QString("Input file '%1' does not exist").arg(job.inputFile));
+    for (const QString &input : job.mergeInputs)
+    {
+        if (!QFileInfo(input).isFile())
+            return errorReply(QString("Input file '%1' does not exist").arg(input));
+    }
+    if (job.speedFactor < 0.01 || job.speedFactor > 100.0)
+        return errorReply("Speed factor must be between 0.01 and 100");
+    if (job.followGrowingInput && job.isMerge())
+        return errorReply("\"follow\" cannot be combined with \"inputs\"");
+    // Followed inputs are never handed to workers
+    if (job.followGrowingInput && queue->maxConcurrentJobs() == 0)
+        return errorReply("\"follow\" needs local encoding slots, but this instance leaves all work to workers");
+
+    if (job.outputFile.isEmpty())
+    {
+        QString outputDir = request.value("outputDir").toString(inputInfo.absolutePath());
+        if (!QDir(outputDir).exists() && !QDir().mkpath(outputDir))
+            return errorReply(QString("Could not create output directory '%1'").arg(outputDir));
+        job.outputFile = job.isMerge()
+                             ? FfmpegCommand::defaultMergeOutputPath(job.mergeInputs, outputDir, job.speedFactor)
+                             : FfmpegCommand::defaultOutputPath(job.inputFile, outputDir, job.speedFactor);
+    }
+
+    const int id = queue->enqueue(job);
+    qDebug() << "Job server accepted job" << id << "for" << job.inputFile;
+    return QJsonObject{{"ok", true}, {"id", id}};
+}
@@ -0,0 +1,58 @@
+#ifndef _JOB_SERVER_H
+#define _JOB_SERVER_H
+
+#include <QObject>
+#include <QJsonObject>
+
+QT_BEGIN_NAMESPACE
+class QLocalServer;
+class QLocalSocket;
+QT_END_NAMESPACE
+
+class JobQueue;
+
+// Local IPC endpoint that lets other processes on the host feed the shared JobQueue.
+//
+// Protocol: one JSON object per line in each direction.
+//   {"cmd":"submit","input":"/a.mp4","speed":2,"outputDir":"/out",
+//    "overlay":{"enabled":true,"fontPath":"/f.ttf","fontSize":48},
+//    "encoderArgs":["-c:v","libx264","-crf","23"]}      -> {"ok":true,"id":1}
+//   {"cmd":"status","id":1}                              -> {"ok":true,"job":{...}}
+//   {"cmd":"list"}                                       -> {"ok":true,"jobs":[...]}
+//   {"cmd":"cancel","id":1}                              -> {"ok":true}
+//   {"cmd":"priority","id":1,"priority":1}               -> {"ok":true}
+// Submitting "inputs":["/a.mp4","/b.mp4",...] instead of "input" joins them, in order, into one output.
+// "follow":true processes an input that is still being recorded; the job ends when the recorder closes it.
+// Higher priorities are pinned ahead of the queue's ordering policy; "submit" accepts "priority" too.
+// Failures are reported as {"ok":false,"error":"..."}.
+// Only the most recent finished, failed or cancelled jobs are kept (see JobQueue::setMaxRetainedJobs).
+class JobServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static QString defaultServerName();
+
+    explicit JobServer(JobQueue *queue, QObject *parent = nullptr);
+    ~JobServer() override;
+
+    // Fails if another instance already serves 'name'; that instance is then the host-wide service.
+    bool listen(const QString &name = defaultServerName());
+    bool isListening() const;
+    QString serverName() const;
+    QString errorString() const;
+
+private slots:
+    void onNewConnection();
+
+private:
+    void onReadyRead(QLocalSocket *socket);
+    QJsonObject handleRequest(const QJsonObject &request);
+    QJsonObject handleSubmit(const QJsonObject &request);
+
+    QLocalServer *server;
+    JobQueue *queue;
+    QString lastError;
+};
+
+#endif // _JOB_SERVER_H
@@ -1,18 +1,189 @@
 #include "main_window.hpp"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QHostInfo>
+#include <QHostAddress>
+#include <QDebug>
+
+#include "job_queue.h"
+#include "job_server.h"
+#include "coordinator.h"
+#include "worker_node.h"
+
+namespace
+{
+    void addOptions(QCommandLineParser &parser)
+    {
+        parser.addHelpOption();
+        parser.addOptions({
+            {"worker", "Run as a headless encoder node for the coordinator at <host:port>.", "host:port"},
+            {"slots", "Number of jobs a worker runs at once (default 1).", "count", "1"},
+            {"name", "Worker name reported to the coordinator (default: host name).", "name"},
+            {"path-map", "Worker only: rewrite job paths starting with <from> to <to>. Repeatable.", "from=to"},
+            {"headless", "Run the job server (and coordinator, if enabled) without a window."},
+            {"coordinator-port", "Accept worker nodes on this TCP port.", "port"},
+            {"bind", "Address the coordinator listens on (default 127.0.0.1; anything else needs --token).", "address", "127.0.0.1"},
+            {"token", "Shared secret between coordinator and workers (default: $VIDEO_SPEED_CHANGER_TOKEN).", "token"},
+            {"local-slots", "Headless only: jobs run on this host at once (default 1, 0 = workers only).", "count", "1"},
+            {"keep-jobs", "Headless only: finished jobs kept for status and list (default 1000).", "count", "1000"},
+            {"ffmpeg", "FFmpeg executable for worker and headless modes (default: ffmpeg).", "path", "ffmpeg"},
+            {"placement", "Worker and headless modes: pin local jobs to core sets: none, cores or cores+memory (default: none).", "policy", "none"},
+        });
+    }
+
+    QString sharedToken(const QCommandLineParser &parser)
+    {
+        return parser.isSet("token") ? parser.value("token") : qEnvironmentVariable("VIDEO_SPEED_CHANGER_TOKEN");
+    }
+
+    QHostAddress bindAddress(const QCommandLineParser &parser)
+    {
+        const QString value = parser.value("bind");
+        return value == "localhost" ? QHostAddress(QHostAddress::LocalHost) : QHostAddress(value);
+    }
+
+    bool applyPlacement(JobQueue *queue, const QString &policy)
+    {
+        if (policy == "cores")
+            queue->setPlacementPolicy(JobQueue::PlacementPolicy::PinCores);
+        else if (policy == "cores+memory")
+            queue->setPlacementPolicy(JobQueue::PlacementPolicy::PinCoresAndMemory);
+        else if (policy != "none")
+            return false;
+        return true;
+    }
+
+    int runWorker(int argc, char *argv[], const QCommandLineParser &parser)
+    {
+        QCoreApplication app(argc, argv);
+
+        const QString endpoint = parser.value("worker");
+        const int colon = endpoint.lastIndexOf(':');
+        const quint16 port = colon > 0 ? endpoint.mid(colon + 1).toUShort() : 0;
+        if (port == 0)
+        {
+            qCritical().noquote() << "--worker expects host:port, got" << endpoint;
+            return 1;
+        }
+
+        const QString host = endpoint.left(colon);
+        const QString token = sharedToken(parser);
+        if (token.isEmpty() && host != "localhost" && !QHostAddress(host).isLoopback())
+        {
+            // Whoever answers on that address could make this node overwrite any file it can write
+            qCritical().noquote() << "--worker needs --token for a coordinator on another host";
+            return 1;
+        }
+
+        const QString name = parser.isSet("name") ? parser.value("name") : QHostInfo::localHostName();
+        WorkerNode worker(host, port, name, parser.value("slots").toInt());
+        worker.setFfmpegPath(parser.value("ffmpeg"));
+        worker.setToken(token);
+        if (!applyPlacement(worker.jobQueue(), parser.value("placement")))
+        {
+            qCritical().noquote() << "--placement expects none, cores or cores+memory, got" << parser.value("placement");
+            return 1;
+        }
+        for (const QString &mapping : parser.values("path-map"))
+        {
+            const int separator = mapping.indexOf('=');
+            if (separator <= 0)
+            {
+                qCritical().noquote() << "--path-map expects from=to, got" << mapping;
+                return 1;
+            }
+            worker.addPathMapping(mapping.left(separator), mapping.mid(separator + 1));
+        }
+        worker.start();
+        return app.exec();
+    }
+
+    int runHeadless(int argc, char *argv[], const QCommandLineParser &parser)
+    {
+        QCoreApplication app(argc, argv);
+
+        JobQueue queue;
+        queue.setFfmpegPath(parser.value("ffmpeg"));
+        queue.setMaxConcurrentJobs(parser.value("local-slots").toInt());
+        queue.setMaxRetainedJobs(parser.value("keep-jobs").toInt());
+        if (!applyPlacement(&queue, parser.value("placement")))
+        {
+            qCritical().noquote() << "--placement expects none, cores or cores+memory, got" << parser.value("placement");
+            return 1;
+        }
+        QObject::connect(&queue, &JobQueue::jobStarted, [](int id, const QStringList &arguments)
+                         { qInfo().noquote() << QString("Job #%1 started:").arg(id) << arguments.join(" "); });
+        QObject::connect(&queue, &JobQueue::jobFinished, [&queue](int id)
+                         {
+            const auto job = queue.job(id);
+            qInfo().noquote() << QString("Job #%1 %2 on %3.").arg(id).arg(encodingJobStateName(job->state), job->assignedNode); });
+
+        JobServer server(&queue);
+        if (!server.listen())
+        {
+            qCritical().noquote() << "Job server not started:" << server.errorString();
+            return 1;
+        }
+        qInfo().noquote() << "Accepting jobs on:" << server.serverName();
+
+        Coordinator coordinator(&queue);
+        QObject::connect(&coordinator, &Coordinator::logMessage, [](const QString &text)
+                         { qInfo().noquote() << text; });
+        if (parser.isSet("coordinator-port"))
+        {
+            const quint16 port = parser.value("coordinator-port").toUShort();
+            const QHostAddress address = bindAddress(parser);
+            if (address.isNull())
+            {
+                qCritical().noquote() << "--bind expects an IP address, got" << parser.value("bind");
+                return 1;
+            }
+            coordinator.setToken(sharedToken(parser));
+            if (!coordinator.listen(port, address))
+            {
+                qCritical().noquote() << "Coordinator could not listen:" << coordinator.errorString();
+                return 1;
+            }
+            qInfo().noquote() << "Coordinator waiting for workers on" << QString("%1:%2").arg(address.toString()).arg(port);
+        }
+        return app.exec();
+    }
+}
 
 int main(int argc, char *argv[])
 {
+    // Parse before creating the application: worker and headless modes must not need a display
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i)
+    {
+        arguments << QString::fromLocal8Bit(argv[i]);
+    }
+    QCommandLineParser parser;
+    addOptions(parser);
+    parser.parse(arguments);
+
+    if (parser.isSet("worker"))
+        return runWorker(argc, argv, parser);
+    if (parser.isSet("headless"))
+        return runHeadless(argc, argv, parser);
+
     QApplication a(argc, argv);
     QApplication::setApplicationName("Video Speed Changer");
     QApplication::setApplicationDisplayName("Video Speed Changer");
+    parser.process(a);
 
     MainWindow w;
 
     QIcon icon(":/assets/icon.png");
     w.setWindowIcon(icon);
 
+    if (parser.isSet("coordinator-port"))
+    {
+        w.speedChangerWidget()->startCoordinator(parser.value("coordinator-port").toUShort(), bindAddress(parser), sharedToken(parser));
+    }
+
     // w.setWindowTitle("My App Title");
     w.resize(800, 600);
     w.show();
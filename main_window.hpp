@@ -11,12 +11,15 @@ class MainWindow : public QMainWindow
 public:
     explicit MainWindow(QWidget *parent = nullptr) : QMainWindow(parent)
     {
-        VideoSpeedChangerWidget *mainWidget = new VideoSpeedChangerWidget(this);
+        mainWidget = new VideoSpeedChangerWidget(this);
         setCentralWidget(mainWidget);
     }
     ~MainWindow() {}
 
+    VideoSpeedChangerWidget *speedChangerWidget() const { return mainWidget; }
+
 private:
+    VideoSpeedChangerWidget *mainWidget;
 };
 
 #endif //_MAIN_WINDOW_HPP
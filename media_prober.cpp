@@ -0,0 +1,135 @@
+#include "media_prober.h"
+
+#include <QProcess>
+#include <QFileInfo>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+namespace
+{
+    // Results kept; the oldest probe is forgotten first
+    const int MAX_CACHE_ENTRIES = 4096;
+}
+
+MediaProber::MediaProber(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void MediaProber::setFfmpegPath(const QString &ffmpegPath)
+{
+    QFileInfo ffmpegInfo(ffmpegPath);
+    QString probeName = ffmpegInfo.fileName().replace("ffmpeg", "ffprobe");
+    if (!probeName.contains("ffprobe"))
+        probeName = "ffprobe";
+    ffprobeExecutable = ffmpegPath.contains('/') || ffmpegPath.contains('\\')
+                            ? ffmpegInfo.dir().filePath(probeName)
+                            : probeName;
+}
+
+bool MediaProber::cachedInfo(const QString &filePath, MediaInfo *info) const
+{
+    auto it = cache.constFind(filePath);
+    if (it == cache.constEnd())
+        return false;
+
+    QFileInfo fileInfo(filePath);
+    if (fileInfo.size() != it->size || fileInfo.lastModified() != it->lastModified)
+        return false;
+    if (info)
+        *info = it->info;
+    return true;
+}
+
+void MediaProber::probe(const QString &filePath)
+{
+    MediaInfo info;
+    if (cachedInfo(filePath, &info))
+    {
+        QMetaObject::invokeMethod(this, [this, filePath, info]()
+                                  { emit probed(filePath, info); }, Qt::QueuedConnection);
+        return;
+    }
+    if (requested.contains(filePath))
+        return;
+
+    requested.insert(filePath);
+    waiting.append(filePath);
+    startNext();
+}
+
+void MediaProber::startNext()
+{
+    while (runningProbes < maxConcurrentProbes && !waiting.isEmpty())
+    {
+        const QString filePath = waiting.takeFirst();
+        QProcess *process = new QProcess(this);
+        connect(process, &QProcess::finished, this, [this, filePath, process]()
+                { onProbeFinished(filePath, process); });
+        connect(process, &QProcess::errorOccurred, this, [this, filePath, process](QProcess::ProcessError error)
+                {
+            if (error == QProcess::FailedToStart)
+                onProbeFinished(filePath, process); });
+
+        runningProbes++;
+        process->start(ffprobeExecutable, {"-v", "error", "-print_format", "json", "-show_format", "-show_streams", filePath});
+    }
+}
+
+void MediaProber::onProbeFinished(const QString &filePath, QProcess *process)
+{
+    runningProbes--;
+    requested.remove(filePath);
+
+    MediaInfo info;
+    if (process->exitStatus() == QProcess::NormalExit && process->exitCode() == 0)
+    {
+        const QJsonObject root = QJsonDocument::fromJson(process->readAllStandardOutput()).object();
+        // ffprobe prints numbers as strings
+        info.durationSeconds = root.value("format").toObject().value("duration").toString().toDouble();
+        info.valid = info.durationSeconds > 0.0;
+
+        for (const QJsonValue &value : root.value("streams").toArray())
+        {
+            const QJsonObject stream = value.toObject();
+            const QString codecType = stream.value("codec_type").toString();
+            if (codecType == "audio")
+            {
+                info.hasAudio = true;
+            }
+            else if (codecType == "video" && info.width == 0 && stream.value("disposition").toObject().value("attached_pic").toInt() == 0)
+            {
+                info.width = stream.value("width").toInt();
+                info.height = stream.value("height").toInt();
+                // "30000/1001"
+                const QStringList rate = stream.value("avg_frame_rate").toString().split('/');
+                const double denominator = rate.value(1, "1").toDouble();
+                info.frameRate = denominator > 0.0 ? rate.value(0).toDouble() / denominator : 0.0;
+            }
+        }
+    }
+    else
+    {
+        qDebug().noquote() << "ffprobe failed for" << filePath << ":" << process->readAllStandardError().trimmed();
+    }
+    process->disconnect();
+    process->deleteLater();
+
+    QFileInfo fileInfo(filePath);
+    cacheOrder.removeOne(filePath);
+    cacheOrder.append(filePath);
+    CacheEntry &entry = cache[filePath];
+    entry.size = fileInfo.size();
+    entry.lastModified = fileInfo.lastModified();
+    entry.info = info;
+    while (cacheOrder.size() > MAX_CACHE_ENTRIES)
+    {
+        cache.remove(cacheOrder.takeFirst());
+    }
+
+    emit probed(filePath, info);
+    startNext();
+}
@@ -0,0 +1,68 @@
+#ifndef _MEDIA_PROBER_H
+#define _MEDIA_PROBER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QDateTime>
+#include <QStringList>
+#include <QMetaType>
+
+QT_BEGIN_NAMESPACE
+class QProcess;
+QT_END_NAMESPACE
+
+struct MediaInfo
+{
+    bool valid = false;
+    double durationSeconds = 0.0;
+
+    // First video stream, and whether there is any audio at all
+    int width = 0;
+    int height = 0;
+    double frameRate = 0.0;
+    bool hasAudio = false;
+};
+Q_DECLARE_METATYPE(MediaInfo)
+
+// Runs ffprobe in the background, a few files at a time, and caches the most recent results
+// by path, size and modification time so re-queued files are not probed again.
+class MediaProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MediaProber(QObject *parent = nullptr);
+
+    // ffprobe is expected next to the ffmpeg executable (or on PATH if ffmpeg is).
+    void setFfmpegPath(const QString &ffmpegPath);
+
+    // Returns the cached result if the file has not changed since it was probed.
+    bool cachedInfo(const QString &filePath, MediaInfo *info) const;
+    // Emits probed() later; immediately (queued) if the file is cached.
+    void probe(const QString &filePath);
+
+signals:
+    void probed(const QString &filePath, const MediaInfo &info);
+
+private:
+    struct CacheEntry
+    {
+        qint64 size = -1;
+        QDateTime lastModified;
+        MediaInfo info;
+    };
+
+    void startNext();
+    void onProbeFinished(const QString &filePath, QProcess *process);
+
+    QString ffprobeExecutable = "ffprobe";
+    int maxConcurrentProbes = 4;
+    int runningProbes = 0;
+    QStringList waiting;
+    QSet<QString> requested; // Waiting or running
+    QHash<QString, CacheEntry> cache;
+    QStringList cacheOrder; // Oldest probe first
+};
+
+#endif // _MEDIA_PROBER_H
@@ -0,0 +1,154 @@
+// Stand-in for ffmpeg used to measure the orchestration layer without real encodes.
+//
+// It accepts any ffmpeg command line, prints a banner and periodic stats to stderr,
+// writes "-progress pipe:1" blocks to stdout and exits with a configurable code.
+// Behaviour is controlled through environment variables:
+//   FAKE_FFMPEG_DURATION_MS           total run time (default 0)
+//   FAKE_FFMPEG_PROGRESS_INTERVAL_MS  time between progress blocks (default 500, as ffmpeg's -stats_period)
+//   FAKE_FFMPEG_MEDIA_SECONDS         output duration reported in progress (default 10)
+//   FAKE_FFMPEG_EXIT_CODE             exit code of every run (default 0)
+//   FAKE_FFMPEG_FAIL_EVERY            if N > 0, every run whose output path hashes to 0 mod N exits 1
+//   FAKE_FFMPEG_CHECK_INPUT           if 1, fail like ffmpeg when the input does not exist (default 0)
+//   FAKE_FFMPEG_WRITE_OUTPUT          if 1, create the output file (default 0)
+//
+// Deliberately free of Qt so that spawning it costs about as much as spawning any small binary.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    long envLong(const char *name, long fallback)
+    {
+        const char *value = std::getenv(name);
+        return value && *value ? std::strtol(value, nullptr, 10) : fallback;
+    }
+
+    bool fileExists(const std::string &path)
+    {
+        std::ifstream file(path);
+        return file.good();
+    }
+
+    void printBanner(const std::string &input)
+    {
+        std::fprintf(stderr,
+                     "ffmpeg version n0.0-fake Copyright (c) 2000-2026 the FFmpeg developers\n"
+                     "  built with fake_ffmpeg\n"
+                     "  configuration: --enable-fake\n"
+                     "  libavutil      59.  8.100 / 59.  8.100\n"
+                     "  libavcodec     61.  3.100 / 61.  3.100\n"
+                     "  libavformat    61.  1.100 / 61.  1.100\n"
+                     "  libavfilter    10.  1.100 / 10.  1.100\n"
+                     "Input #0, mov,mp4,m4a,3gp,3g2,mj2, from '%s':\n"
+                     "  Duration: 00:00:10.00, start: 0.000000, bitrate: 8000 kb/s\n"
+                     "  Stream #0:0(und): Video: h264 (High) (avc1 / 0x31637661), yuv420p, 1920x1080, 30 fps\n"
+                     "  Stream #0:1(und): Audio: aac (LC) (mp4a / 0x6134706D), 48000 Hz, stereo, fltp, 128 kb/s\n"
+                     "Stream mapping:\n"
+                     "  Stream #0:0 -> #0:0 (h264 (native) -> h264 (libx264))\n"
+                     "  Stream #0:1 -> #0:1 (aac (native) -> aac (native))\n"
+                     "Press [q] to stop, [?] for help\n",
+                     input.c_str());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (const std::string &arg : args)
+    {
+        if (arg == "-version")
+        {
+            std::printf("ffmpeg version n0.0-fake\n");
+            return 0;
+        }
+    }
+
+    std::string input;
+    std::string output;
+    bool progressToStdout = false;
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "-i" && i + 1 < args.size())
+            input = args[++i];
+        else if (args[i] == "-progress" && i + 1 < args.size())
+            progressToStdout = args[++i] == "pipe:1";
+    }
+    if (!args.empty() && args.back()[0] != '-')
+        output = args.back();
+
+    if (input.empty() || output.empty())
+    {
+        std::fprintf(stderr, "At least one output file must be specified\n");
+        return 1;
+    }
+
+    printBanner(input);
+    if (envLong("FAKE_FFMPEG_CHECK_INPUT", 0) == 1 && !fileExists(input))
+    {
+        std::fprintf(stderr, "%s: No such file or directory\n", input.c_str());
+        return 1;
+    }
+
+    const long durationMs = envLong("FAKE_FFMPEG_DURATION_MS", 0);
+    const long intervalMs = std::max(1L, envLong("FAKE_FFMPEG_PROGRESS_INTERVAL_MS", 500));
+    const double mediaSeconds = static_cast<double>(envLong("FAKE_FFMPEG_MEDIA_SECONDS", 10));
+    const double fps = 30.0;
+
+    const auto start = std::chrono::steady_clock::now();
+    long elapsedMs = 0;
+    do
+    {
+        const long step = std::min(intervalMs, durationMs - elapsedMs);
+        if (step > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(step));
+        elapsedMs = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                          std::chrono::steady_clock::now() - start)
+                                          .count());
+
+        const double fraction = durationMs > 0 ? std::min(1.0, static_cast<double>(elapsedMs) / durationMs) : 1.0;
+        const double outSeconds = fraction * mediaSeconds;
+        const long frame = static_cast<long>(outSeconds * fps);
+        const double speed = elapsedMs > 0 ? outSeconds * 1000.0 / elapsedMs : 0.0;
+        const bool done = elapsedMs >= durationMs;
+
+        std::fprintf(stderr, "frame=%5ld fps=%.0f q=28.0 size=%8ldkB time=%02d:%02d:%05.2f bitrate=8000.0kbits/s speed=%.2fx%s",
+                     frame, fps, frame * 33, static_cast<int>(outSeconds / 3600), static_cast<int>(outSeconds / 60) % 60,
+                     outSeconds - 60 * static_cast<int>(outSeconds / 60), speed, done ? "\n" : "\r");
+        if (progressToStdout)
+        {
+            const long long outUs = static_cast<long long>(outSeconds * 1000000.0);
+            std::printf("frame=%ld\nfps=%.2f\nbitrate=8000.0kbits/s\ntotal_size=%ld\nout_time_us=%lld\nout_time_ms=%lld\n"
+                        "speed=%.2fx\nprogress=%s\n",
+                        frame, fps, frame * 33 * 1024, outUs, outUs, speed, done ? "end" : "continue");
+            std::fflush(stdout);
+        }
+        std::fflush(stderr);
+    } while (elapsedMs < durationMs);
+
+    long exitCode = envLong("FAKE_FFMPEG_EXIT_CODE", 0);
+    const long failEvery = envLong("FAKE_FFMPEG_FAIL_EVERY", 0);
+    if (exitCode == 0 && failEvery > 0 && std::hash<std::string>{}(output) % failEvery == 0)
+        exitCode = 1;
+
+    if (exitCode != 0)
+    {
+        std::fprintf(stderr, "Error while encoding '%s': fake failure\n", output.c_str());
+        return static_cast<int>(exitCode);
+    }
+
+    if (envLong("FAKE_FFMPEG_WRITE_OUTPUT", 0) == 1)
+    {
+        std::ofstream file(output, std::ios::binary | std::ios::trunc);
+        file << "fake";
+    }
+    std::fprintf(stderr, "video:330kB audio:160kB subtitle:0kB other streams:0kB global headers:0kB muxing overhead: 0.5%%\n");
+    return 0;
+}
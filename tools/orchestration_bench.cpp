@@ -0,0 +1,207 @@
+// Drives the headless JobQueue through a large batch of fake_ffmpeg jobs and reports
+// how much time and memory the orchestration layer itself costs:
+//   - per-job overhead: wall time of a job minus the fake encode time (spawn, pipes, signals)
+//   - dispatch gap: time from a slot freeing up to the next job being started
+//   - event-loop latency: lateness of a 10 ms timer while the batch runs
+//   - memory: resident set size before, during and after the batch
+//
+//   orchestration_bench --jobs 100000 --parallel 8 --duration-ms 0
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QTimer>
+#include <QHash>
+#include <QTextStream>
+
+#include <algorithm>
+#include <vector>
+
+#include "job_queue.h"
+
+namespace
+{
+    qint64 residentKiB()
+    {
+        QFile status("/proc/self/status");
+        if (!status.open(QIODevice::ReadOnly))
+            return -1;
+        while (!status.atEnd())
+        {
+            const QByteArray line = status.readLine();
+            if (line.startsWith("VmRSS:"))
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+        return -1;
+    }
+
+    QString summarize(std::vector<double> values, const char *unit)
+    {
+        if (values.empty())
+            return "n/a";
+        std::sort(values.begin(), values.end());
+        auto percentile = [&values](double p)
+        { return values[static_cast<size_t>(p * (values.size() - 1))]; };
+        return QString("p50 %1 %5, p90 %2 %5, p99 %3 %5, max %4 %5")
+            .arg(percentile(0.50), 0, 'f', 3)
+            .arg(percentile(0.90), 0, 'f', 3)
+            .arg(percentile(0.99), 0, 'f', 3)
+            .arg(values.back(), 0, 'f', 3)
+            .arg(unit);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures JobQueue overhead with a fake ffmpeg.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"jobs", "Number of jobs to run.", "count", "10000"},
+        {"parallel", "Concurrent jobs.", "count", "1"},
+        {"duration-ms", "Run time of each fake encode.", "ms", "0"},
+        {"fail-every", "Make roughly one in N jobs fail (0 = none).", "n", "0"},
+        {"policy", "Ordering policy: fifo, shortest or longest.", "policy", "fifo"},
+        {"fake-ffmpeg", "Path to fake_ffmpeg (default: next to this executable).", "path"},
+    });
+    parser.process(app);
+
+    const int jobCount = parser.value("jobs").toInt();
+    if (jobCount <= 0)
+    {
+        qCritical("--jobs must be positive");
+        return 1;
+    }
+    const int parallel = qMax(1, parser.value("parallel").toInt());
+    const int durationMs = parser.value("duration-ms").toInt();
+    const QString fakeFfmpeg = parser.isSet("fake-ffmpeg")
+                                   ? parser.value("fake-ffmpeg")
+                                   : QDir(QCoreApplication::applicationDirPath()).filePath("fake_ffmpeg");
+
+    // Children inherit these
+    qputenv("FAKE_FFMPEG_DURATION_MS", QByteArray::number(durationMs));
+    qputenv("FAKE_FFMPEG_FAIL_EVERY", parser.value("fail-every").toLatin1());
+
+    QTextStream out(stdout);
+    const qint64 rssStart = residentKiB();
+
+    JobQueue queue;
+    queue.setFfmpegPath(fakeFfmpeg);
+    queue.setMaxConcurrentJobs(parallel);
+    const QString policy = parser.value("policy");
+    if (policy == "shortest")
+        queue.setOrderingPolicy(JobQueue::OrderingPolicy::ShortestFirst);
+    else if (policy == "longest")
+        queue.setOrderingPolicy(JobQueue::OrderingPolicy::LongestFirst);
+
+    QElapsedTimer clock;
+    clock.start();
+
+    std::vector<double> jobOverheadMs;
+    std::vector<double> dispatchGapMs;
+    std::vector<double> loopLatencyMs;
+    std::vector<qint64> rssSamples;
+    jobOverheadMs.reserve(jobCount);
+    dispatchGapMs.reserve(jobCount);
+    QHash<int, qint64> startedAtNs;
+    qint64 lastFinishNs = -1;
+    qint64 logBytes = 0;
+    int finished = 0;
+    int failed = 0;
+
+    QObject::connect(&queue, &JobQueue::jobStarted, [&](int id, const QStringList &)
+                     {
+        const qint64 now = clock.nsecsElapsed();
+        startedAtNs.insert(id, now);
+        if (lastFinishNs >= 0)
+        {
+            dispatchGapMs.push_back((now - lastFinishNs) / 1e6);
+            lastFinishNs = -1;
+        } });
+    QObject::connect(&queue, &JobQueue::jobLog, [&](int, const QString &text)
+                     { logBytes += text.size(); });
+    QObject::connect(&queue, &JobQueue::jobFinished, [&](int id)
+                     {
+        const qint64 now = clock.nsecsElapsed();
+        jobOverheadMs.push_back((now - startedAtNs.take(id)) / 1e6 - durationMs);
+        lastFinishNs = now;
+        if (queue.job(id)->state != EncodingJob::State::Finished)
+            failed++;
+        if (++finished % qMax(1, jobCount / 10) == 0)
+        {
+            rssSamples.push_back(residentKiB());
+            out << QString("  %1/%2 jobs, RSS %3 KiB").arg(finished).arg(jobCount).arg(rssSamples.back()) << Qt::endl;
+        } });
+
+    // A stand-in for the UI thread's responsiveness: how late does a 10 ms tick fire?
+    QTimer ticker;
+    ticker.setTimerType(Qt::PreciseTimer);
+    qint64 lastTickNs = 0;
+    QObject::connect(&ticker, &QTimer::timeout, [&]()
+                     {
+        const qint64 now = clock.nsecsElapsed();
+        if (lastTickNs > 0)
+            loopLatencyMs.push_back(qMax(0.0, (now - lastTickNs) / 1e6 - 10.0));
+        lastTickNs = now; });
+
+    QElapsedTimer enqueueTimer;
+    enqueueTimer.start();
+    const QString outputDir = QDir::temp().filePath("orchestration_bench");
+    for (int i = 0; i < jobCount; ++i)
+    {
+        EncodingJob job;
+        job.origin = "bench";
+        job.inputFile = QString("/bench/input_%1.mp4").arg(i);
+        job.outputFile = QDir(outputDir).filePath(QString("output_%1.mp4").arg(i));
+        job.speedFactor = 2.0;
+        // Known up front, as if already probed: the inputs don't exist, and ffprobe runs would be
+        // measured as orchestration overhead. Varied so the shortest/longest policies have work to do.
+        job.durationSeconds = 1.0 + (static_cast<qint64>(i) * 7919) % 3600;
+        queue.enqueue(job);
+    }
+    const double enqueueMs = enqueueTimer.nsecsElapsed() / 1e6;
+    const qint64 rssQueued = residentKiB();
+
+    out << QString("Running %1 jobs, %2 in parallel, %3 ms per fake encode, using %4")
+               .arg(jobCount)
+               .arg(parallel)
+               .arg(durationMs)
+               .arg(fakeFfmpeg)
+        << Qt::endl;
+
+    QElapsedTimer batchTimer;
+    QObject::connect(&queue, &JobQueue::idle, &app, &QCoreApplication::quit);
+    QTimer::singleShot(0, [&]()
+                       {
+        batchTimer.start();
+        ticker.start(10); });
+    app.exec();
+    const double batchSeconds = batchTimer.nsecsElapsed() / 1e9;
+    const qint64 rssEnd = residentKiB();
+
+    const double idealSeconds = static_cast<double>(jobCount) * durationMs / 1000.0 / parallel;
+    out << Qt::endl
+        << "Results" << Qt::endl
+        << QString("  jobs finished         %1 (%2 failed)").arg(finished).arg(failed) << Qt::endl
+        << QString("  batch wall time       %1 s (ideal %2 s), %3 jobs/s")
+               .arg(batchSeconds, 0, 'f', 2)
+               .arg(idealSeconds, 0, 'f', 2)
+               .arg(finished / qMax(batchSeconds, 1e-9), 0, 'f', 1)
+        << Qt::endl
+        << QString("  enqueue               %1 ms total, %2 us/job").arg(enqueueMs, 0, 'f', 1).arg(enqueueMs * 1000.0 / qMax(1, jobCount), 0, 'f', 2) << Qt::endl
+        << QString("  per-job overhead      %1").arg(summarize(jobOverheadMs, "ms")) << Qt::endl
+        << QString("  dispatch gap          %1").arg(summarize(dispatchGapMs, "ms")) << Qt::endl
+        << QString("  event-loop latency    %1").arg(summarize(loopLatencyMs, "ms")) << Qt::endl
+        << QString("  log traffic           %1 KiB").arg(logBytes / 1024) << Qt::endl
+        << QString("  RSS                   start %1 KiB, queued %2 KiB, end %3 KiB (+%4 KiB/1000 jobs)")
+               .arg(rssStart)
+               .arg(rssQueued)
+               .arg(rssEnd)
+               .arg((rssEnd - rssStart) * 1000.0 / qMax(1, jobCount), 0, 'f', 1)
+        << Qt::endl;
+    return 0;
+}
@@ -5,7 +5,9 @@
 #include <QFormLayout>
 #include <QMessageBox>
 #include <QStandardPaths>
+#include <QFile>
 #include <QFileInfo>
+#include <QDateTime>
 #include <QDir>
 #include <QDebug>
 #include <QUrl>
@@ -22,16 +24,36 @@
 #include <QDoubleSpinBox>
 #include <QLineEdit>
 #include <QLabel>
-#include <QRegularExpression>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QThread>
+#include <QCryptographicHash>
+#include <QDesktopServices>
+
+#include "job_queue.h"
+#include "job_server.h"
+#include "coordinator.h"
+#include "ffmpeg_command.h"
 
 // Anonymous namespace for constants local to this translation unit
 namespace
 {
     const QStringList VIDEO_EXTENSIONS_LIST = {"*.mp4", "*.mkv", "*.avi", "*.mov", "*.wmv", "*.flv", "*.webm"};
+
+    // Per-item data in the video list
+    const int FILE_PATH_ROLE = Qt::UserRole;
+    const int PINNED_ROLE = Qt::UserRole + 1;
+    const int PINNED_PRIORITY = 1;
+
+    // Previews trade quality for turnaround: small frames and the fastest x264 preset
+    const int PREVIEW_HEIGHT = 360;
+    const QStringList PREVIEW_ENCODER_ARGS = {"-c:v", "libx264", "-preset", "ultrafast", "-crf", "30", "-c:a", "aac"};
+    // Most recently used previews kept on disk
+    const int MAX_CACHED_PREVIEWS = 20;
 }
 
 VideoSpeedChangerWidget::VideoSpeedChangerWidget(QWidget *parent)
-    : QWidget(parent), outputDirectory(QDir::currentPath()), ffmpegProcess(nullptr)
+    : QWidget(parent), outputDirectory(QDir::currentPath()), jobQueue(new JobQueue(this)), previewQueue(new JobQueue(this)), jobServer(nullptr), coordinator(nullptr)
 {
 #if defined(Q_OS_WIN)
     defaultFontPath = "C:/Windows/Fonts/arial.ttf";
@@ -53,25 +75,50 @@ VideoSpeedChangerWidget::VideoSpeedChangerWidget(QWidget *parent)
     }
 #endif
 
+    connect(jobQueue, &JobQueue::jobStarted, this, &VideoSpeedChangerWidget::onJobStarted);
+    connect(jobQueue, &JobQueue::jobFinished, this, &VideoSpeedChangerWidget::onJobFinished);
+    connect(jobQueue, &JobQueue::jobLog, this, &VideoSpeedChangerWidget::onJobLog);
+    connect(previewQueue, &JobQueue::jobFinished, this, &VideoSpeedChangerWidget::onPreviewFinished);
+    connect(previewQueue, &JobQueue::jobLog, this, &VideoSpeedChangerWidget::onJobLog);
+
     setupUi();
     loadSettings();
     updateProcessButtonState();
     setAcceptDrops(true);
+
+    jobServer = new JobServer(jobQueue, this);
+    if (jobServer->listen())
+    {
+        logOutputArea->appendPlainText("Accepting jobs from other processes on: " + jobServer->serverName());
+    }
+    else
+    {
+        // Submitting through the other instance's socket is not implemented: this window keeps its own queue
+        logOutputArea->appendPlainText("Job server not started: " + jobServer->errorString());
+        logOutputArea->appendPlainText("Videos processed in this window run in its own queue, in parallel with that instance's jobs.");
+    }
 }
 
 VideoSpeedChangerWidget::~VideoSpeedChangerWidget()
 {
     saveSettings();
-    if (ffmpegProcess)
+}
+
+bool VideoSpeedChangerWidget::startCoordinator(quint16 port, const QHostAddress &address, const QString &token)
+{
+    if (!coordinator)
     {
-        if (ffmpegProcess->state() != QProcess::NotRunning)
-        {
-            ffmpegProcess->kill();
-            ffmpegProcess->waitForFinished(1000);
-        }
-        delete ffmpegProcess;
-        ffmpegProcess = nullptr;
+        coordinator = new Coordinator(jobQueue, this);
+        connect(coordinator, &Coordinator::logMessage, logOutputArea, &QPlainTextEdit::appendPlainText);
+    }
+    coordinator->setToken(token);
+    if (!coordinator->listen(port, address))
+    {
+        logOutputArea->appendPlainText(QString("Coordinator could not listen on %1:%2: %3").arg(address.toString()).arg(port).arg(coordinator->errorString()));
+        return false;
     }
+    logOutputArea->appendPlainText(QString("Coordinator waiting for workers on %1:%2.").arg(address.toString()).arg(port));
+    return true;
 }
 
 void VideoSpeedChangerWidget::setupUi()
@@ -92,6 +139,8 @@ void VideoSpeedChangerWidget::setupUi()
 
     connect(chooseFfmpegPathButton, &QPushButton::clicked, this, &VideoSpeedChangerWidget::chooseFfmpegPath);
     connect(ffmpegPathEdit, &QLineEdit::textChanged, this, &VideoSpeedChangerWidget::updateProcessButtonState);
+    connect(ffmpegPathEdit, &QLineEdit::textChanged, jobQueue, &JobQueue::setFfmpegPath);
+    connect(ffmpegPathEdit, &QLineEdit::textChanged, previewQueue, &JobQueue::setFfmpegPath);
 
     // Video Files Section
     QGroupBox *videoFilesGroup = new QGroupBox("Video Files", this);
@@ -102,7 +151,10 @@ void VideoSpeedChangerWidget::setupUi()
     QHBoxLayout *videoButtonsLayout = new QHBoxLayout();
     chooseVideoFilesButton = new QPushButton("Add Videos...", this);
     clearListButton = new QPushButton("Clear List", this);
+    pinButton = new QPushButton("Pin / Unpin", this);
+    pinButton->setToolTip("Pinned videos are processed before all others, whatever the ordering");
     videoButtonsLayout->addWidget(chooseVideoFilesButton);
+    videoButtonsLayout->addWidget(pinButton);
     videoButtonsLayout->addWidget(clearListButton);
     videoFilesLayout->addWidget(videoFilesListWidget);
     videoFilesLayout->addLayout(videoButtonsLayout);
@@ -111,6 +163,7 @@ void VideoSpeedChangerWidget::setupUi()
 
     connect(chooseVideoFilesButton, &QPushButton::clicked, this, &VideoSpeedChangerWidget::chooseVideoFiles);
     connect(clearListButton, &QPushButton::clicked, this, &VideoSpeedChangerWidget::clearVideoList);
+    connect(pinButton, &QPushButton::clicked, this, &VideoSpeedChangerWidget::togglePinSelected);
     connect(videoFilesListWidget->model(), &QAbstractItemModel::rowsInserted, this, &VideoSpeedChangerWidget::updateProcessButtonState);
     connect(videoFilesListWidget->model(), &QAbstractItemModel::rowsRemoved, this, &VideoSpeedChangerWidget::updateProcessButtonState);
 
@@ -125,6 +178,42 @@ void VideoSpeedChangerWidget::setupUi()
     speedFactorSpinBox->setSingleStep(0.1);
     settingsLayout->addRow("Speed Factor (e.g., 0.5 for half speed):", speedFactorSpinBox);
 
+    orderingComboBox = new QComboBox(this);
+    orderingComboBox->addItem("List order", static_cast<int>(JobQueue::OrderingPolicy::Fifo));
+    orderingComboBox->addItem("Shortest first (earliest results)", static_cast<int>(JobQueue::OrderingPolicy::ShortestFirst));
+    orderingComboBox->addItem("Longest first (fastest parallel batch)", static_cast<int>(JobQueue::OrderingPolicy::LongestFirst));
+    settingsLayout->addRow("Processing Order:", orderingComboBox);
+
+    parallelJobsSpinBox = new QSpinBox(this);
+    parallelJobsSpinBox->setRange(1, qMax(1, QThread::idealThreadCount()));
+    parallelJobsSpinBox->setValue(1);
+    settingsLayout->addRow("Parallel Jobs:", parallelJobsSpinBox);
+
+    placementComboBox = new QComboBox(this);
+    placementComboBox->addItem("Let the system decide", static_cast<int>(JobQueue::PlacementPolicy::None));
+    placementComboBox->addItem("Pin each job to its own cores", static_cast<int>(JobQueue::PlacementPolicy::PinCores));
+    placementComboBox->addItem("Pin cores and keep memory on their NUMA node", static_cast<int>(JobQueue::PlacementPolicy::PinCoresAndMemory));
+    if (CpuTopology::detect().isEmpty())
+    {
+        placementComboBox->setEnabled(false);
+        placementComboBox->setToolTip("CPU placement is only available on Linux");
+    }
+    settingsLayout->addRow("CPU Placement:", placementComboBox);
+
+    mergeCheckBox = new QCheckBox("Join all videos, in list order, into one output file", this);
+    mergeCheckBox->setToolTip("Decodes and encodes every frame once: no intermediate files, no separate concat pass");
+    settingsLayout->addRow("Merge:", mergeCheckBox);
+
+    followCheckBox = new QCheckBox("Start on videos that are still being recorded", this);
+    followCheckBox->setToolTip("Follows each file as it grows and finishes when the recorder closes it.\n"
+                               "The recording must be MKV, MPEG-TS or fragmented MP4.");
+    settingsLayout->addRow("Live Input:", followCheckBox);
+    // A merge needs every input complete up front
+    connect(mergeCheckBox, &QCheckBox::toggled, this, [this](bool checked)
+            { if (checked) followCheckBox->setChecked(false); });
+    connect(followCheckBox, &QCheckBox::toggled, this, [this](bool checked)
+            { if (checked) mergeCheckBox->setChecked(false); });
+
     QHBoxLayout *outputDirLayout = new QHBoxLayout();
     outputDirLabel = new QLabel("Output Directory: " + outputDirectory, this);
     outputDirLabel->setWordWrap(true);
@@ -132,10 +221,25 @@ void VideoSpeedChangerWidget::setupUi()
     outputDirLayout->addWidget(outputDirLabel, 1);
     outputDirLayout->addWidget(chooseOutputDirButton);
     settingsLayout->addRow(outputDirLayout);
+
+    QHBoxLayout *previewLayout = new QHBoxLayout();
+    previewSecondsSpinBox = new QSpinBox(this);
+    previewSecondsSpinBox->setRange(1, 600);
+    previewSecondsSpinBox->setValue(10);
+    previewSecondsSpinBox->setSuffix(" s");
+    previewButton = new QPushButton("Preview", this);
+    previewButton->setToolTip("Render the first seconds of the selected video at low resolution and open it");
+    previewLayout->addWidget(previewSecondsSpinBox, 1);
+    previewLayout->addWidget(previewButton);
+    settingsLayout->addRow("Preview Length:", previewLayout);
     settingsGroup->setLayout(settingsLayout);
     mainLayout->addWidget(settingsGroup);
 
     connect(chooseOutputDirButton, &QPushButton::clicked, this, &VideoSpeedChangerWidget::chooseOutputDirectory);
+    connect(previewButton, &QPushButton::clicked, this, &VideoSpeedChangerWidget::previewVideo);
+    connect(orderingComboBox, &QComboBox::currentIndexChanged, this, &VideoSpeedChangerWidget::onOrderingChanged);
+    connect(parallelJobsSpinBox, &QSpinBox::valueChanged, jobQueue, &JobQueue::setMaxConcurrentJobs);
+    connect(placementComboBox, &QComboBox::currentIndexChanged, this, &VideoSpeedChangerWidget::onPlacementChanged);
     connect(speedFactorSpinBox, &QDoubleSpinBox::valueChanged, this, &VideoSpeedChangerWidget::updateProcessButtonState);
 
     // Overlay Text Section
@@ -233,11 +337,7 @@ void VideoSpeedChangerWidget::dropEvent(QDropEvent *event)
             for (const QUrl &url : validUrls)
             {
                 QString filePath = url.toLocalFile();
-                if (!videoFilePaths.contains(filePath))
-                {
-                    videoFilePaths.insert(filePath);
-                    videoFilesListWidget->addItem(QFileInfo(filePath).fileName() + " (" + filePath + ")");
-                }
+                addVideoFile(filePath);
             }
             updateProcessButtonState();
             event->acceptProposedAction();
@@ -300,10 +400,9 @@ void VideoSpeedChangerWidget::chooseVideoFiles()
         for (const QUrl &url : urls)
         {
             QString filePath = url.toLocalFile();
-            if (!filePath.isEmpty() && !videoFilePaths.contains(filePath) && isValidVideoFile(filePath))
+            if (!filePath.isEmpty() && isValidVideoFile(filePath))
             {
-                videoFilePaths.insert(filePath);
-                videoFilesListWidget->addItem(QFileInfo(filePath).fileName() + " (" + filePath + ")");
+                addVideoFile(filePath);
             }
         }
         updateProcessButtonState();
@@ -323,6 +422,38 @@ void VideoSpeedChangerWidget::chooseOutputDirectory()
     }
 }
 
+void VideoSpeedChangerWidget::addVideoFile(const QString &filePath)
+{
+    if (videoFilePaths.contains(filePath))
+        return;
+    videoFilePaths.insert(filePath);
+    QListWidgetItem *item = new QListWidgetItem(QFileInfo(filePath).fileName() + " (" + filePath + ")");
+    item->setData(FILE_PATH_ROLE, filePath);
+    videoFilesListWidget->addItem(item);
+}
+
+void VideoSpeedChangerWidget::togglePinSelected()
+{
+    for (QListWidgetItem *item : videoFilesListWidget->selectedItems())
+    {
+        const bool pinned = !item->data(PINNED_ROLE).toBool();
+        item->setData(PINNED_ROLE, pinned);
+        QFont font = item->font();
+        font.setBold(pinned);
+        item->setFont(font);
+    }
+}
+
+void VideoSpeedChangerWidget::onOrderingChanged(int index)
+{
+    jobQueue->setOrderingPolicy(static_cast<JobQueue::OrderingPolicy>(orderingComboBox->itemData(index).toInt()));
+}
+
+void VideoSpeedChangerWidget::onPlacementChanged(int index)
+{
+    jobQueue->setPlacementPolicy(static_cast<JobQueue::PlacementPolicy>(placementComboBox->itemData(index).toInt()));
+}
+
 void VideoSpeedChangerWidget::clearVideoList()
 {
     videoFilesListWidget->clear();
@@ -378,73 +509,250 @@ void VideoSpeedChangerWidget::processVideos()
         }
     }
 
-    filesToProcess = videoFilePaths.values();
-    totalFilesToProcess = filesToProcess.size();
+    const bool merge = mergeCheckBox->isChecked();
+    totalFilesToProcess = merge ? 1 : videoFilesListWidget->count();
     filesProcessedCount = 0;
+    batchJobsStarted = 0;
 
     logOutputArea->clear();
-    logOutputArea->appendPlainText(QString("Starting batch processing of %1 videos...").arg(totalFilesToProcess));
+    if (merge)
+    {
+        logOutputArea->appendPlainText(QString("Probing %1 videos to merge them into one file...").arg(videoFilesListWidget->count()));
+    }
+    else
+    {
+        logOutputArea->appendPlainText(QString("Starting batch processing of %1 videos...").arg(totalFilesToProcess));
+    }
+    if (!jobServer->isListening())
+    {
+        logOutputArea->appendPlainText("Note: another instance serves the host-wide queue; these jobs run alongside it, not through it.");
+    }
 
     progressBar->setRange(0, totalFilesToProcess);
     progressBar->setValue(0);
     progressBar->setVisible(true);
     setControlsEnabled(false);
 
-    processNextVideo();
+    jobQueue->setFfmpegPath(ffmpegPathEdit->text());
+    if (merge)
+    {
+        QStringList inputFiles;
+        for (int row = 0; row < videoFilesListWidget->count(); ++row)
+        {
+            inputFiles << videoFilesListWidget->item(row)->data(FILE_PATH_ROLE).toString();
+        }
+        EncodingJob job = jobFromControls(inputFiles.first());
+        job.mergeInputs = inputFiles;
+        job.outputFile = FfmpegCommand::defaultMergeOutputPath(inputFiles, outputDirectory, job.speedFactor);
+        batchJobIds.insert(jobQueue->enqueue(job));
+        return;
+    }
+
+    // Enqueued in list order; the queue's ordering policy and the pins decide what runs first
+    for (int row = 0; row < videoFilesListWidget->count(); ++row)
+    {
+        QListWidgetItem *item = videoFilesListWidget->item(row);
+        EncodingJob job = jobFromControls(item->data(FILE_PATH_ROLE).toString());
+        job.outputFile = FfmpegCommand::defaultOutputPath(job.inputFile, outputDirectory, job.speedFactor);
+        job.priority = item->data(PINNED_ROLE).toBool() ? PINNED_PRIORITY : 0;
+        batchJobIds.insert(jobQueue->enqueue(job));
+    }
+}
+
+EncodingJob VideoSpeedChangerWidget::jobFromControls(const QString &inputFile) const
+{
+    EncodingJob job;
+    job.origin = "ui";
+    job.inputFile = inputFile;
+    job.speedFactor = speedFactorSpinBox->value();
+    job.overlayEnabled = overlayGroupBox->isChecked();
+    job.fontPath = fontPathEdit->text();
+    job.fontSize = fontSizeSpinBox->value();
+    job.followGrowingInput = followCheckBox->isChecked();
+    return job;
+}
+
+void VideoSpeedChangerWidget::previewVideo()
+{
+    QListWidgetItem *item = videoFilesListWidget->currentItem();
+    if (!item && videoFilesListWidget->count() > 0)
+        item = videoFilesListWidget->item(0);
+    if (!item)
+        return;
+
+    EncodingJob job = jobFromControls(item->data(FILE_PATH_ROLE).toString());
+    job.inputDurationLimit = previewSecondsSpinBox->value();
+    job.followGrowingInput = false;
+    job.scaleHeight = PREVIEW_HEIGHT;
+    job.encoderArgs = PREVIEW_ENCODER_ARGS;
+
+    const QString cachePath = previewCachePath(job);
+    if (QFileInfo::exists(cachePath))
+    {
+        logOutputArea->appendPlainText("Opening cached preview: " + cachePath);
+        // Mark as recently used so pruning keeps it
+        QFile cached(cachePath);
+        if (cached.open(QIODevice::ReadWrite))
+            cached.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        QDesktopServices::openUrl(QUrl::fromLocalFile(cachePath));
+        return;
+    }
+    if (!QDir().mkpath(QFileInfo(cachePath).absolutePath()))
+    {
+        QMessageBox::critical(this, "Preview Error", "Could not create preview cache directory: " + QFileInfo(cachePath).absolutePath());
+        return;
+    }
+
+    // Render next to the cache entry and rename on success, so an aborted render is never served
+    job.outputFile = cachePath;
+    job.outputFile.insert(job.outputFile.size() - 4, ".part");
+    const int id = previewQueue->enqueue(job);
+    previewOutputs.insert(id, cachePath);
+    logOutputArea->appendPlainText(QString("Rendering %1 s preview of %2 ...").arg(previewSecondsSpinBox->value()).arg(QFileInfo(job.inputFile).fileName()));
+}
+
+void VideoSpeedChangerWidget::onPreviewFinished(int id)
+{
+    const QString cachePath = previewOutputs.take(id);
+    const auto job = previewQueue->job(id);
+    if (!job || cachePath.isEmpty())
+        return;
+
+    if (job->state != EncodingJob::State::Finished)
+    {
+        QFile::remove(job->outputFile);
+        logOutputArea->appendPlainText(QString("Preview failed (exit code %1): %2").arg(job->exitCode).arg(job->errorString));
+        return;
+    }
+    QFile::remove(cachePath);
+    if (!QFile::rename(job->outputFile, cachePath))
+    {
+        logOutputArea->appendPlainText("Could not store preview in cache: " + cachePath);
+        QDesktopServices::openUrl(QUrl::fromLocalFile(job->outputFile));
+        return;
+    }
+    prunePreviewCache(QFileInfo(cachePath).absolutePath());
+    logOutputArea->appendPlainText("Preview ready: " + cachePath);
+    QDesktopServices::openUrl(QUrl::fromLocalFile(cachePath));
+}
+
+QString VideoSpeedChangerWidget::previewCachePath(const EncodingJob &previewJob) const
+{
+    // Keyed by the exact ffmpeg arguments plus the input's identity, so any change to
+    // speed, overlay or length is a different entry and going back to an old setting is a hit
+    EncodingJob keyJob = previewJob;
+    keyJob.outputFile = "preview.mp4";
+    QFileInfo inputInfo(previewJob.inputFile);
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(FfmpegCommand::buildArguments(keyJob).join('\n').toUtf8());
+    hash.addData(QByteArray::number(inputInfo.size()));
+    hash.addData(QByteArray::number(inputInfo.lastModified().toMSecsSinceEpoch()));
+
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/previews";
+    return QDir(cacheDir).filePath(QString::fromLatin1(hash.result().toHex()) + ".mp4");
+}
+
+void VideoSpeedChangerWidget::prunePreviewCache(const QString &cacheDir)
+{
+    // Newest first; renders still in progress (".part.mp4") are left alone
+    const QFileInfoList entries = QDir(cacheDir).entryInfoList({"*.mp4"}, QDir::Files, QDir::Time);
+    int kept = 0;
+    for (const QFileInfo &entry : entries)
+    {
+        if (entry.fileName().endsWith(".part.mp4"))
+            continue;
+        if (++kept > MAX_CACHED_PREVIEWS)
+            QFile::remove(entry.absoluteFilePath());
+    }
 }
 
-void VideoSpeedChangerWidget::onFfmpegProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void VideoSpeedChangerWidget::onJobStarted(int id, const QStringList &arguments)
 {
-    QString currentFileNameForLog = QFileInfo(currentInputFile).fileName();
-    if (!ffmpegProcess)
+    const auto job = jobQueue->job(id);
+    if (!job)
+        return;
+
+    if (batchJobIds.contains(id))
     {
-        logOutputArea->appendPlainText(QString("FFmpeg process for %1 was unexpectedly null during finish.").arg(currentFileNameForLog));
+        logOutputArea->appendPlainText(QString("\nProcessing (%1/%2): %3 -> %4")
+                                           .arg(++batchJobsStarted)
+                                           .arg(totalFilesToProcess)
+                                           .arg(QFileInfo(job->inputFile).fileName())
+                                           .arg(QFileInfo(job->outputFile).fileName()));
     }
     else
     {
-        if (exitStatus == QProcess::CrashExit)
+        logOutputArea->appendPlainText(QString("\nProcessing job #%1 (%2): %3 -> %4")
+                                           .arg(id)
+                                           .arg(job->origin)
+                                           .arg(QFileInfo(job->inputFile).fileName())
+                                           .arg(QFileInfo(job->outputFile).fileName()));
+    }
+    logOutputArea->appendPlainText("FFmpeg command: " + jobQueue->ffmpegPath() + " " + arguments.join(" "));
+}
+
+void VideoSpeedChangerWidget::onJobFinished(int id)
+{
+    const auto job = jobQueue->job(id);
+    if (!job)
+        return;
+
+    const QString inputFileName = QFileInfo(job->inputFile).fileName();
+    const bool interactive = job->origin == "ui";
+    switch (job->state)
+    {
+    case EncodingJob::State::Finished:
+        logOutputArea->appendPlainText(QString("Successfully processed: %1").arg(QFileInfo(job->outputFile).fileName()));
+        break;
+    case EncodingJob::State::Cancelled:
+        logOutputArea->appendPlainText(QString("Cancelled: %1 (%2)").arg(inputFileName, job->errorString));
+        break;
+    case EncodingJob::State::Failed:
+        if (job->exitCode == -1)
         {
-            logOutputArea->appendPlainText(QString("Error: FFmpeg crashed while processing %1. Error: %2").arg(currentFileNameForLog, ffmpegProcess->errorString()));
-            QMessageBox::critical(this, "FFmpeg Crash", "FFmpeg crashed. Check logs for details on file: " + currentFileNameForLog);
+            logOutputArea->appendPlainText(QString("Error: FFmpeg crashed while processing %1. Error: %2").arg(inputFileName, job->errorString));
+            if (interactive)
+                QMessageBox::critical(this, "FFmpeg Crash", "FFmpeg crashed. Check logs for details on file: " + inputFileName);
         }
-        else if (exitCode != 0)
+        else
         {
-            logOutputArea->appendPlainText(QString("Error: FFmpeg failed (exit code %1) for %2. Error: %3").arg(exitCode).arg(currentFileNameForLog, ffmpegProcess->errorString()));
-            QMessageBox::warning(this, "Processing Error", QString("Failed to process %1. Exit code: %2.").arg(currentFileNameForLog).arg(exitCode));
+            logOutputArea->appendPlainText(QString("Error: FFmpeg failed (exit code %1) for %2. Error: %3").arg(job->exitCode).arg(inputFileName, job->errorString));
+            if (interactive)
+                QMessageBox::warning(this, "Processing Error", QString("Failed to process %1. Exit code: %2.").arg(inputFileName).arg(job->exitCode));
         }
-        else
+        break;
+    default:
+        break;
+    }
+
+    if (batchJobIds.remove(id))
+    {
+        if (job->state == EncodingJob::State::Finished)
         {
-            logOutputArea->appendPlainText(QString("Successfully processed: %1").arg(QFileInfo(currentOutputFile).fileName()));
             filesProcessedCount++;
             progressBar->setValue(filesProcessedCount);
         }
-
-        ffmpegProcess->disconnect();
-        ffmpegProcess->deleteLater();
-        ffmpegProcess = nullptr;
+        if (batchJobIds.isEmpty())
+        {
+            finishBatch();
+        }
     }
-
-    processNextVideo();
 }
 
-void VideoSpeedChangerWidget::onFfmpegReadyReadStandardOutput()
+void VideoSpeedChangerWidget::onJobLog(int id, const QString &text)
 {
-    if (ffmpegProcess)
-    {
-        QByteArray data = ffmpegProcess->readAllStandardOutput();
-        logOutputArea->appendPlainText(QString::fromUtf8(data).trimmed());
-        qDebug().noquote() << "FFMPEG_STDOUT:" << QString::fromUtf8(data).trimmed();
-    }
+    Q_UNUSED(id);
+    logOutputArea->appendPlainText(text);
 }
 
-void VideoSpeedChangerWidget::onFfmpegReadyReadStandardError()
+void VideoSpeedChangerWidget::finishBatch()
 {
-    if (ffmpegProcess)
-    {
-        QByteArray data = ffmpegProcess->readAllStandardError();
-        logOutputArea->appendPlainText(QString::fromLocal8Bit(data).trimmed());
-        qDebug().noquote() << "FFMPEG_STDERR:" << QString::fromLocal8Bit(data).trimmed();
-    }
+    progressBar->setVisible(false);
+    QMessageBox::information(this, "Processing Complete", QString("All %1 videos processed successfully.").arg(totalFilesToProcess));
+    logOutputArea->appendPlainText("All videos processed.");
+    setControlsEnabled(true);
+    updateProcessButtonState();
 }
 
 void VideoSpeedChangerWidget::updateProcessButtonState()
@@ -452,9 +760,10 @@ void VideoSpeedChangerWidget::updateProcessButtonState()
     bool hasFiles = videoFilesListWidget->count() > 0;
     bool outputDirSelected = !outputDirectory.isEmpty() && QDir(outputDirectory).exists();
     bool ffmpegPathOk = !ffmpegPathEdit->text().isEmpty();
-    bool isProcessing = (ffmpegProcess && ffmpegProcess->state() != QProcess::NotRunning) || !filesToProcess.isEmpty();
+    bool isProcessing = !batchJobIds.isEmpty();
 
     processVideosButton->setEnabled(hasFiles && outputDirSelected && ffmpegPathOk && !isProcessing);
+    previewButton->setEnabled(hasFiles && ffmpegPathOk);
 }
 
 void VideoSpeedChangerWidget::onOverlayEnabledChanged(bool checked)
@@ -480,6 +789,12 @@ void VideoSpeedChangerWidget::loadSettings()
     overlayGroupBox->setChecked(settings.value("overlayEnabled", false).toBool());
     fontPathEdit->setText(settings.value("fontPath", defaultFontPath).toString());
     fontSizeSpinBox->setValue(settings.value("fontSize", 64).toInt());
+    previewSecondsSpinBox->setValue(settings.value("previewSeconds", 10).toInt());
+    orderingComboBox->setCurrentIndex(qMax(0, orderingComboBox->findData(settings.value("orderingPolicy", 0).toInt())));
+    parallelJobsSpinBox->setValue(settings.value("parallelJobs", 1).toInt());
+    placementComboBox->setCurrentIndex(qMax(0, placementComboBox->findData(settings.value("cpuPlacement", 0).toInt())));
+    mergeCheckBox->setChecked(settings.value("mergeOutputs", false).toBool());
+    followCheckBox->setChecked(settings.value("followGrowingInputs", false).toBool());
     onOverlayEnabledChanged(overlayGroupBox->isChecked());
 }
 
@@ -492,162 +807,15 @@ void VideoSpeedChangerWidget::saveSettings()
     settings.setValue("overlayEnabled", overlayGroupBox->isChecked());
     settings.setValue("fontPath", fontPathEdit->text());
     settings.setValue("fontSize", fontSizeSpinBox->value());
+    settings.setValue("previewSeconds", previewSecondsSpinBox->value());
+    settings.setValue("orderingPolicy", orderingComboBox->currentData().toInt());
+    settings.setValue("parallelJobs", parallelJobsSpinBox->value());
+    settings.setValue("cpuPlacement", placementComboBox->currentData().toInt());
+    settings.setValue("mergeOutputs", mergeCheckBox->isChecked());
+    settings.setValue("followGrowingInputs", followCheckBox->isChecked());
 }
 
 
-// Helper function: remove trailing zeros and dot from a double string
-static QString cleanDoubleString(double value)
-{
-    QString s = QString::number(value, 'f', 2);
-    s = s.replace(QRegularExpression("(\\.\\d*?[1-9])0+$"), "\\1"); // Remove unnecessary trailing zeros after decimal point
-    s = s.replace(QRegularExpression("\\.0+$"), ""); // Remove .00
-    if (s.endsWith('.')) s.chop(1);
-    return s;
-}
-
-void VideoSpeedChangerWidget::processNextVideo()
-{
-    if (filesToProcess.isEmpty())
-    {
-        progressBar->setVisible(false);
-        QMessageBox::information(this, "Processing Complete", QString("All %1 videos processed successfully.").arg(totalFilesToProcess));
-        logOutputArea->appendPlainText("All videos processed.");
-        setControlsEnabled(true);
-        updateProcessButtonState();
-        return;
-    }
-
-    currentInputFile = filesToProcess.takeFirst();
-    QFileInfo inputFileInfo(currentInputFile);
-    QString baseName = inputFileInfo.completeBaseName();
-    QString extension = inputFileInfo.suffix();
-    double speed = speedFactorSpinBox->value();
-    QString speedStr = cleanDoubleString(speed);
-
-    currentOutputFile = QDir(outputDirectory).filePath(QString("%1_x%2.%3").arg(baseName).arg(speedStr).arg(extension));
-
-    if (ffmpegProcess)
-    {
-        if (ffmpegProcess->state() != QProcess::NotRunning)
-        {
-            ffmpegProcess->kill();
-            ffmpegProcess->waitForFinished(500);
-        }
-        delete ffmpegProcess;
-        ffmpegProcess = nullptr;
-    }
-    ffmpegProcess = new QProcess(this);
-    ffmpegProcess->disconnect();
-
-    connect(ffmpegProcess, &QProcess::finished, this, &VideoSpeedChangerWidget::onFfmpegProcessFinished);
-    connect(ffmpegProcess, &QProcess::readyReadStandardOutput, this, &VideoSpeedChangerWidget::onFfmpegReadyReadStandardOutput);
-    connect(ffmpegProcess, &QProcess::readyReadStandardError, this, &VideoSpeedChangerWidget::onFfmpegReadyReadStandardError);
-    connect(ffmpegProcess, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error)
-            {
-        logOutputArea->appendPlainText(QString("FFmpeg process error: %1 for file %2. FFmpeg error string: %3")
-                                       .arg(static_cast<int>(error))
-                                       .arg(QFileInfo(currentInputFile).fileName())
-                                       .arg(ffmpegProcess ? ffmpegProcess->errorString() : "N/A"));
-        onFfmpegProcessFinished(-1, QProcess::CrashExit); });
-
-    QStringList arguments;
-    arguments << "-i" << currentInputFile;
-
-    QString videoFilterSetpts = QString("setpts=%1*PTS").arg(QString::number(1.0 / speed, 'f', 4));
-    QStringList videoFilters;
-    videoFilters << videoFilterSetpts;
-
-    if (overlayGroupBox->isChecked())
-    {
-        QString fontFile = fontPathEdit->text();
-        QFileInfo fontInfo(fontFile);
-        if (fontFile.isEmpty() || !fontInfo.exists() || !fontInfo.isFile())
-        {
-            logOutputArea->appendPlainText(QString("Warning: Font file '%1' not found or invalid for overlay on '%2'. Skipping overlay.").arg(fontFile, inputFileInfo.fileName()));
-        }
-        else
-        {
-            QString text = QString("x %1").arg(cleanDoubleString(speed));
-            int fontSize = fontSizeSpinBox->value();
-            QString escapedFontFile = fontFile;
-#ifdef Q_OS_WIN
-            escapedFontFile.replace("\\", "/");
-            escapedFontFile.replace(":", "\\\\:");
-#endif
-            qDebug() << "Escaped font path:" << escapedFontFile;
-            QString drawTextFilter = QString("drawtext=text='%1':fontcolor=white:fontsize=%2:x=w-tw-10:y=h-th-10:shadowcolor=black:shadowx=2:shadowy=2:fontfile=\"%3\"")
-                                         .arg(text.replace("'", "\\'"), QString::number(fontSize), escapedFontFile);
-            videoFilters << drawTextFilter;
-        }
-    }
-    arguments << "-vf" << videoFilters.join(",");
-
-    QStringList atempoAudioFilters = generateAtempoFilter(speed);
-    if (!atempoAudioFilters.isEmpty())
-    {
-        arguments << "-af" << atempoAudioFilters.join(",");
-    }
-
-    arguments << "-y" << currentOutputFile;
-
-    logOutputArea->appendPlainText(QString("\nProcessing (%1/%2): %3 -> %4")
-                                       .arg(filesProcessedCount + 1)
-                                       .arg(totalFilesToProcess)
-                                       .arg(inputFileInfo.fileName())
-                                       .arg(QFileInfo(currentOutputFile).fileName()));
-    logOutputArea->appendPlainText("FFmpeg command: " + ffmpegPathEdit->text() + " " + arguments.join(" "));
-    qDebug() << "Starting ffmpeg with:" << ffmpegPathEdit->text() << arguments;
-
-    ffmpegProcess->start(ffmpegPathEdit->text(), arguments);
-    if (!ffmpegProcess->waitForStarted(5000))
-    {
-        logOutputArea->appendPlainText(QString("Error: Failed to start FFmpeg for %1. Timeout or other error. Process error: %2")
-                                           .arg(inputFileInfo.fileName())
-                                           .arg(ffmpegProcess->errorString()));
-        qDebug() << "FFmpeg failed to start. Error: " << ffmpegProcess->errorString();
-        onFfmpegProcessFinished(ffmpegProcess->exitCode(), QProcess::CrashExit);
-        return;
-    }
-}
-
-QStringList VideoSpeedChangerWidget::generateAtempoFilter(double speedFactor)
-{
-    QStringList atempoFilters;
-    if (speedFactor <= 0.001)
-    {
-        return {"atempo=1.0"};
-    }
-
-    double currentFactor = speedFactor;
-    for (int i = 0; i < 10 && (currentFactor < 0.5 || currentFactor > 2.0); ++i)
-    {
-        if (currentFactor < 0.5)
-        {
-            atempoFilters.append("atempo=0.5");
-            currentFactor /= 0.5;
-        }
-        else
-        {
-            atempoFilters.append("atempo=2.0");
-            currentFactor /= 2.0;
-        }
-    }
-    if (currentFactor >= 0.01 && currentFactor <= 100.0)
-    { // Ensure final factor is somewhat reasonable
-        atempoFilters.append(QString("atempo=%1").arg(QString::number(currentFactor, 'f', 4)));
-    }
-    else if (atempoFilters.isEmpty())
-    {                                       // If loop didn't run, and factor is still bad
-        atempoFilters.append("atempo=1.0"); // Fallback
-    }
-
-    if (atempoFilters.isEmpty())
-    {
-        return {"atempo=1.0"};
-    }
-    return atempoFilters;
-}
-
 bool VideoSpeedChangerWidget::isValidVideoFile(const QString &filePath)
 {
     QFileInfo fileInfo(filePath);
@@ -663,9 +831,12 @@ void VideoSpeedChangerWidget::setControlsEnabled(bool enabled)
     chooseFfmpegPathButton->setEnabled(enabled);
     chooseVideoFilesButton->setEnabled(enabled);
     clearListButton->setEnabled(enabled);
+    pinButton->setEnabled(enabled);
     chooseOutputDirButton->setEnabled(enabled);
     speedFactorSpinBox->setEnabled(enabled);
     overlayGroupBox->setEnabled(enabled);
+    mergeCheckBox->setEnabled(enabled);
+    followCheckBox->setEnabled(enabled);
     if (enabled)
     {
         onOverlayEnabledChanged(overlayGroupBox->isChecked()); // Restore based on checkbox
@@ -2,7 +2,11 @@
 #define _VIDEO_SPEED_CHANGER_WIDGET_H
 
 #include <QWidget>
-#include <QProcess>
+#include <QSet>
+#include <QHash>
+#include <QHostAddress>
+
+#include "encoding_job.h"
 #include <QStringList> // For forward declaration if needed, or for VIDEO_EXTENSIONS_LIST if kept here
 
 // Forward declarations for Qt classes to minimize header includes
@@ -16,10 +20,16 @@ class QProgressBar;
 class QGroupBox;
 class QSpinBox;
 class QPlainTextEdit;
+class QComboBox;
+class QCheckBox;
 class QDragEnterEvent;
 class QMimeData;
 QT_END_NAMESPACE
 
+class JobQueue;
+class JobServer;
+class Coordinator;
+
 // It's common to declare constants like this in the .cpp if they are only used there,
 // or in the .hpp (e.g., in a namespace or as static const member) if needed by users of the header.
 // For this case, VIDEO_EXTENSIONS_LIST is used in slots implemented in .cpp, so it can be in .cpp.
@@ -34,6 +44,9 @@ public:
     explicit VideoSpeedChangerWidget(QWidget *parent = nullptr);
     ~VideoSpeedChangerWidget() override;
 
+    // Also hands queued jobs to worker nodes connecting on 'port'.
+    bool startCoordinator(quint16 port, const QHostAddress &address, const QString &token);
+
 protected:
     void dragEnterEvent(QDragEnterEvent *event) override;
     void dropEvent(QDropEvent *event) override;
@@ -44,18 +57,26 @@ private slots:
     void chooseOutputDirectory();
     void clearVideoList();
     void processVideos();
-    void onFfmpegProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
-    void onFfmpegReadyReadStandardOutput();
-    void onFfmpegReadyReadStandardError();
+    void previewVideo();
+    void onPreviewFinished(int id);
+    void onJobStarted(int id, const QStringList &arguments);
+    void onJobFinished(int id);
+    void onJobLog(int id, const QString &text);
     void updateProcessButtonState();
     void onOverlayEnabledChanged(bool checked);
+    void togglePinSelected();
+    void onOrderingChanged(int index);
+    void onPlacementChanged(int index);
 
 private:
     void setupUi();
     void loadSettings();
     void saveSettings();
-    void processNextVideo();
-    QStringList generateAtempoFilter(double speedFactor);
+    void finishBatch();
+    void addVideoFile(const QString &filePath);
+    EncodingJob jobFromControls(const QString &inputFile) const;
+    QString previewCachePath(const EncodingJob &previewJob) const;
+    void prunePreviewCache(const QString &cacheDir);
     bool isValidVideoFile(const QString &filePath);
     void setControlsEnabled(bool enabled);
 
@@ -66,8 +87,14 @@ private:
     QListWidget *videoFilesListWidget;
     QPushButton *chooseVideoFilesButton;
     QPushButton *clearListButton;
+    QPushButton *pinButton;
 
     QDoubleSpinBox *speedFactorSpinBox;
+    QComboBox *orderingComboBox;
+    QSpinBox *parallelJobsSpinBox;
+    QComboBox *placementComboBox;
+    QCheckBox *mergeCheckBox;
+    QCheckBox *followCheckBox;
 
     QLabel *outputDirLabel;
     QPushButton *chooseOutputDirButton;
@@ -78,19 +105,25 @@ private:
     QPushButton *chooseFontPathButton;
     QSpinBox *fontSizeSpinBox;
 
+    QSpinBox *previewSecondsSpinBox;
+    QPushButton *previewButton;
+
     QPushButton *processVideosButton;
     QProgressBar *progressBar;
     QPlainTextEdit *logOutputArea;
 
     // State Variables
     QSet<QString> videoFilePaths;
-    QStringList filesToProcess;
+    QSet<int> batchJobIds; // UI batch jobs not finished yet
     int totalFilesToProcess = 0;
+    int batchJobsStarted = 0;
     int filesProcessedCount = 0;
 
-    QProcess *ffmpegProcess;
-    QString currentInputFile;
-    QString currentOutputFile;
+    JobQueue *jobQueue;
+    JobQueue *previewQueue; // Separate so previews never wait behind a batch
+    QHash<int, QString> previewOutputs; // Preview job id -> cache file it will be renamed to
+    JobServer *jobServer;
+    Coordinator *coordinator;
     QString defaultFfmpegPath = "ffmpeg";
     QString defaultFontPath;
 };
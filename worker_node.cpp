@@ -0,0 +1,215 @@
+#include "worker_node.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QDebug>
+
+#include "job_queue.h"
+
+namespace
+{
+    const int RECONNECT_INTERVAL_MS = 3000;
+    const int STATUS_INTERVAL_MS = 5000;
+
+    double readLoadAverage()
+    {
+        QFile file("/proc/loadavg");
+        if (!file.open(QIODevice::ReadOnly))
+            return 0.0;
+        return file.readLine().split(' ').value(0).toDouble();
+    }
+}
+
+WorkerNode::WorkerNode(const QString &host, quint16 port, const QString &name, int slots, QObject *parent)
+    : QObject(parent), host(host), port(port), name(name), slots(qMax(1, slots)),
+      socket(new QTcpSocket(this)), reconnectTimer(new QTimer(this)), statusTimer(new QTimer(this)),
+      queue(new JobQueue(this))
+{
+    queue->setMaxConcurrentJobs(this->slots);
+
+    reconnectTimer->setSingleShot(true);
+    reconnectTimer->setInterval(RECONNECT_INTERVAL_MS);
+    statusTimer->setInterval(STATUS_INTERVAL_MS);
+
+    connect(reconnectTimer, &QTimer::timeout, this, &WorkerNode::connectToCoordinator);
+    connect(statusTimer, &QTimer::timeout, this, &WorkerNode::sendStatus);
+    connect(socket, &QTcpSocket::connected, this, &WorkerNode::onConnected);
+    connect(socket, &QTcpSocket::readyRead, this, &WorkerNode::onReadyRead);
+    connect(socket, &QTcpSocket::disconnected, this, &WorkerNode::onDisconnected);
+    connect(socket, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError)
+            {
+        qWarning().noquote() << "Worker" << this->name << "connection error:" << socket->errorString();
+        if (socket->state() == QAbstractSocket::UnconnectedState)
+            reconnectTimer->start(); });
+
+    connect(queue, &JobQueue::jobProgress, this, &WorkerNode::onJobProgress);
+    connect(queue, &JobQueue::jobFinished, this, &WorkerNode::onJobFinished);
+    connect(queue, &JobQueue::jobLog, this, [](int localId, const QString &text)
+            { qDebug().noquote() << QString("[job %1]").arg(localId) << text; });
+}
+
+WorkerNode::~WorkerNode()
+{
+    socket->disconnect(this);
+}
+
+void WorkerNode::setFfmpegPath(const QString &path)
+{
+    queue->setFfmpegPath(path);
+}
+
+void WorkerNode::setToken(const QString &token)
+{
+    this->token = token;
+}
+
+JobQueue *WorkerNode::jobQueue() const
+{
+    return queue;
+}
+
+void WorkerNode::addPathMapping(const QString &coordinatorPrefix, const QString &localPrefix)
+{
+    pathMappings.append(qMakePair(coordinatorPrefix, localPrefix));
+}
+
+void WorkerNode::start()
+{
+    connectToCoordinator();
+}
+
+void WorkerNode::connectToCoordinator()
+{
+    qInfo().noquote() << QString("Worker %1 connecting to %2:%3 ...").arg(name, host).arg(port);
+    socket->connectToHost(host, port);
+}
+
+void WorkerNode::onConnected()
+{
+    qInfo().noquote() << QString("Worker %1 connected with %2 slots.").arg(name).arg(slots);
+    send(QJsonObject{{"type", "hello"}, {"name", name}, {"slots", slots}, {"token", token}});
+    statusTimer->start();
+}
+
+void WorkerNode::onDisconnected()
+{
+    statusTimer->stop();
+    // The coordinator reassigns whatever was in flight, so don't keep encoding it here
+    const QList<int> localIds = remoteIdByLocalId.keys();
+    remoteIdByLocalId.clear();
+    startTimes.clear();
+    for (int localId : localIds)
+    {
+        queue->cancel(localId);
+    }
+    qWarning().noquote() << QString("Worker %1 lost the coordinator; retrying in %2 ms.").arg(name).arg(RECONNECT_INTERVAL_MS);
+    reconnectTimer->start();
+}
+
+void WorkerNode::onReadyRead()
+{
+    while (socket->canReadLine())
+    {
+        const QJsonDocument document = QJsonDocument::fromJson(socket->readLine().trimmed());
+        if (!document.isObject())
+            continue;
+
+        const QJsonObject message = document.object();
+        const QString type = message.value("type").toString();
+        if (type == "error")
+        {
+            qWarning().noquote() << "Worker" << name << "rejected by coordinator:" << message.value("error").toString();
+            continue;
+        }
+        // Assignments name output files and ffmpeg arguments: only take them from a peer that knows the token
+        if (message.value("token").toString() != token)
+        {
+            qWarning().noquote() << "Worker" << name << "ignoring" << type << "message without the shared token";
+            continue;
+        }
+        if (type == "assign")
+        {
+            handleAssign(message.value("job").toObject());
+        }
+        else if (type == "cancel")
+        {
+            const int remoteId = message.value("id").toInt();
+            const int localId = remoteIdByLocalId.key(remoteId, 0);
+            if (localId != 0)
+                queue->cancel(localId);
+        }
+    }
+}
+
+void WorkerNode::handleAssign(const QJsonObject &jobObject)
+{
+    EncodingJob job = encodingJobFromJson(jobObject);
+    job.origin = "ipc";
+    job.inputFile = mapPath(job.inputFile);
+    job.outputFile = mapPath(job.outputFile);
+    job.fontPath = mapPath(job.fontPath);
+    for (QString &input : job.mergeInputs)
+    {
+        input = mapPath(input);
+    }
+
+    const int remoteId = jobObject.value("id").toInt();
+    const int localId = queue->enqueue(job);
+    remoteIdByLocalId.insert(localId, remoteId);
+    startTimes[localId].start();
+    qInfo().noquote() << QString("Worker %1 accepted job #%2: %3").arg(name).arg(remoteId).arg(job.inputFile);
+}
+
+void WorkerNode::onJobProgress(int localId)
+{
+    const auto job = queue->job(localId);
+    if (!job || !remoteIdByLocalId.contains(localId))
+        return;
+    send(QJsonObject{{"type", "progress"},
+                     {"id", remoteIdByLocalId.value(localId)},
+                     {"outTime", job->progressSeconds},
+                     {"fps", job->fps}});
+}
+
+void WorkerNode::onJobFinished(int localId)
+{
+    const auto job = queue->job(localId);
+    if (!job || !remoteIdByLocalId.contains(localId))
+        return;
+
+    const double wallSeconds = startTimes.take(localId).elapsed() / 1000.0;
+    send(QJsonObject{{"type", "result"},
+                     {"id", remoteIdByLocalId.take(localId)},
+                     {"state", encodingJobStateName(job->state)},
+                     {"exitCode", job->exitCode},
+                     {"error", job->errorString},
+                     {"wallSeconds", wallSeconds},
+                     {"fps", job->fps}});
+}
+
+void WorkerNode::sendStatus()
+{
+    send(QJsonObject{{"type", "status"},
+                     {"running", queue->runningCount()},
+                     {"slots", slots},
+                     {"loadAverage", readLoadAverage()}});
+}
+
+QString WorkerNode::mapPath(const QString &path) const
+{
+    for (const auto &mapping : pathMappings)
+    {
+        if (path.startsWith(mapping.first))
+            return mapping.second + path.mid(mapping.first.size());
+    }
+    return path;
+}
+
+void WorkerNode::send(const QJsonObject &message)
+{
+    if (socket->state() != QAbstractSocket::ConnectedState)
+        return;
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n");
+}
@@ -0,0 +1,67 @@
+#ifndef _WORKER_NODE_H
+#define _WORKER_NODE_H
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+
+QT_BEGIN_NAMESPACE
+class QTcpSocket;
+class QTimer;
+QT_END_NAMESPACE
+
+class JobQueue;
+
+// Headless encoder node: connects to a Coordinator, runs the jobs it is assigned
+// on a local JobQueue and reports progress, metrics and results back.
+class WorkerNode : public QObject
+{
+    Q_OBJECT
+
+public:
+    WorkerNode(const QString &host, quint16 port, const QString &name, int slots, QObject *parent = nullptr);
+    ~WorkerNode() override;
+
+    void setFfmpegPath(const QString &path);
+    // Sent in hello and required on every assignment and cancel from the coordinator.
+    void setToken(const QString &token);
+    JobQueue *jobQueue() const;
+    // Rewrites path prefixes of assigned jobs when the shared storage is mounted elsewhere on this node.
+    void addPathMapping(const QString &coordinatorPrefix, const QString &localPrefix);
+
+    void start();
+
+private slots:
+    void connectToCoordinator();
+    void onConnected();
+    void onReadyRead();
+    void onDisconnected();
+    void sendStatus();
+
+private:
+    void handleAssign(const QJsonObject &jobObject);
+    void onJobProgress(int localId);
+    void onJobFinished(int localId);
+    QString mapPath(const QString &path) const;
+    void send(const QJsonObject &message);
+
+    QString host;
+    quint16 port;
+    QString name;
+    int slots;
+    QString token;
+
+    QTcpSocket *socket;
+    QTimer *reconnectTimer;
+    QTimer *statusTimer;
+    JobQueue *queue;
+
+    QList<QPair<QString, QString>> pathMappings;
+    QHash<int, int> remoteIdByLocalId;
+    QHash<int, QElapsedTimer> startTimes;
+};
+
+#endif // _WORKER_NODE_H